@@ -11,7 +11,9 @@
 #define ZEN_ALLOC_HPP
 
 #include <concepts>
+#include <limits>
 #include <new>
+#include <type_traits>
 #include <utility>
 
 #include "zen/config.hpp"
@@ -68,19 +70,42 @@ concept DynamicAllocator = requires (
   { t.allocate(size, alignment, destroy) } -> std::same_as<void*>;
 };
 
+/// The concept of allocators that can also hand out memory without keeping
+/// track of a destructor.
+///
+/// Such memory can only hold objects that are trivially destructible, but it
+/// does not carry any bookkeeping and it is released without having to visit
+/// the objects inside it.
+template<typename T>
+concept TrivialAllocator = requires (
+  T& t,
+  std::size_t size,
+  std::size_t alignment
+) {
+  { t.allocate(size, alignment) } -> std::same_as<void*>;
+};
+
 /// Construct an object inside the memory provided by the given allocator.
 ///
+/// If @p R is trivially destructible and the allocator is a
+/// @ref TrivialAllocator, no destructor is registered for the object.
+///
 /// @include construct.cc
 ///
 /// @see bump_ptr_pool for a simple allocator for dynamic objects
 /// @see growing_bump_ptr_pool for an allocator that grows in size when out of memory
 template<typename R, DynamicAllocator Alloc, typename ...Ts>
 R* construct(Alloc& allocator, Ts&& ...args) {
-  auto ptr = allocator.allocate(
-    sizeof(R),
-    alignof(R),
-    [](void* ptr) { static_cast<R*>(ptr)->~R(); }
-  );
+  void* ptr;
+  if constexpr (std::is_trivially_destructible_v<R> && TrivialAllocator<Alloc>) {
+    ptr = allocator.allocate(sizeof(R), alignof(R));
+  } else {
+    ptr = allocator.allocate(
+      sizeof(R),
+      alignof(R),
+      [](void* ptr) { static_cast<R*>(ptr)->~R(); }
+    );
+  }
   if (ZEN_UNLIKELY(!ptr)) {
     return nullptr;
   }
@@ -88,6 +113,114 @@ R* construct(Alloc& allocator, Ts&& ...args) {
   return std::launder(reinterpret_cast<R*>(ptr));
 }
 
+/// A destructor that does nothing, for memory that does not hold an object
+/// which needs to be destroyed.
+inline void destroy_nothing(void*) {}
+
+/// A non-owning, type-erased reference to a @ref DynamicAllocator.
+///
+/// This allows code that is not a template, such as a parser inside a
+/// translation unit, to allocate using any allocator that the user provides.
+/// The referenced allocator must outlive this object.
+class allocator_ref {
+
+  void* _allocator;
+  void* (*_allocate)(void* allocator, std::size_t size, std::size_t alignment, destroy_fn destroy);
+  void* (*_allocate_trivial)(void* allocator, std::size_t size, std::size_t alignment);
+
+public:
+
+  template<DynamicAllocator Alloc>
+    requires (!std::same_as<Alloc, allocator_ref>)
+  allocator_ref(Alloc& allocator):
+    _allocator(&allocator),
+    _allocate([](void* allocator, std::size_t size, std::size_t alignment, destroy_fn destroy) {
+      return static_cast<Alloc*>(allocator)->allocate(size, alignment, destroy);
+    }),
+    _allocate_trivial([](void* allocator, std::size_t size, std::size_t alignment) {
+      if constexpr (TrivialAllocator<Alloc>) {
+        return static_cast<Alloc*>(allocator)->allocate(size, alignment);
+      } else {
+        return static_cast<Alloc*>(allocator)->allocate(size, alignment, destroy_nothing);
+      }
+    }) {}
+
+  void* allocate(std::size_t size, std::size_t alignment, destroy_fn destroy) {
+    return _allocate(_allocator, size, alignment, destroy);
+  }
+
+  void* allocate(std::size_t size, std::size_t alignment) {
+    return _allocate_trivial(_allocator, size, alignment);
+  }
+
+  bool operator==(const allocator_ref& other) const {
+    return _allocator == other._allocator;
+  }
+
+};
+
+/// An allocator for the containers of the standard library that carves its
+/// memory out of a @ref DynamicAllocator.
+///
+/// Deallocating is a no-op: the memory is reclaimed all at once when the
+/// underlying allocator is destroyed. This makes it a good fit for data
+/// structures that die together, such as a document that was parsed for
+/// the duration of a single request.
+///
+/// ```
+/// zen::growing_bump_ptr_pool pool;
+/// std::vector<int, zen::pool_allocator<int>> numbers { pool };
+/// ```
+template<typename T>
+class pool_allocator {
+
+  template<typename U>
+  friend class pool_allocator;
+
+  allocator_ref _ref;
+
+public:
+
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  pool_allocator(allocator_ref ref):
+    _ref(ref) {}
+
+  template<DynamicAllocator Alloc>
+  pool_allocator(Alloc& allocator):
+    _ref(allocator) {}
+
+  template<typename U>
+  pool_allocator(const pool_allocator<U>& other):
+    _ref(other._ref) {}
+
+  T* allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    auto ptr = _ref.allocate(n * sizeof(T), alignof(T));
+    if (ZEN_UNLIKELY(!ptr)) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T*, std::size_t) noexcept {}
+
+  allocator_ref get_ref() const {
+    return _ref;
+  }
+
+  template<typename U>
+  bool operator==(const pool_allocator<U>& other) const {
+    return _ref == other._ref;
+  }
+
+};
+
 ZEN_NAMESPACE_END
 
 #endif // of #ifndef ZEN_ALLOC_HPP
@@ -9,15 +9,18 @@
 #ifndef ZEN_BUMP_PTR_POOL_HPP
 #define ZEN_BUMP_PTR_POOL_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstring>
-#include <list>
 #include <memory>
 #include <new>
+#include <vector>
 
 #include "zen/config.hpp"
 #include "zen/math.hpp"
 #include "zen/alloc.hpp"
+#include "zen/transformer.hpp"
 
 #define ZEN_DEFAULT_POOL_CHUNK_SIZE 65536
 
@@ -25,6 +28,95 @@
 
 ZEN_NAMESPACE_START
 
+/// Where the memory of a @ref bump_ptr_pool comes from.
+enum class pool_backing {
+
+  /// Allocate chunks with `new`.
+  heap,
+
+  /// Map chunks directly from the operating system. Pages are only
+  /// committed when they are first written to, so a large chunk costs
+  /// nothing until it is used.
+  mapped,
+
+  /// Like @ref pool_backing::mapped, but align the chunk to a huge page
+  /// boundary and ask the kernel to back it with huge pages where possible,
+  /// which reduces TLB misses for chunks of several megabytes.
+  huge_pages,
+
+};
+
+/// @brief Counters that describe how a pool has been used.
+///
+/// Statistics are opt-in: a pool only updates them after they have been
+/// attached to it with `set_stats()`. The same object can be attached to
+/// several pools to get the totals of all of them. It must outlive the pools
+/// it is attached to, so that it can still be inspected after they were
+/// destroyed.
+///
+/// This type can be passed to a @ref transformer, for instance to dump it
+/// with an encoder from @ref make_json_encoder.
+struct pool_stats {
+
+  /// The sum of all sizes that were passed to `allocate()`.
+  std::size_t bytes_requested = 0;
+
+  /// The total capacity of all chunks that were counted.
+  std::size_t bytes_reserved = 0;
+
+  /// The bytes that were skipped to satisfy alignment requirements.
+  std::size_t bytes_padding = 0;
+
+  /// The bytes that were taken up by the headers of objects that need to be
+  /// destroyed.
+  std::size_t bytes_headers = 0;
+
+  /// The bytes that are currently allocated, including padding and headers.
+  std::size_t bytes_in_use = 0;
+
+  /// The largest value that @ref bytes_in_use ever had.
+  std::size_t high_water_mark = 0;
+
+  std::size_t num_allocations = 0;
+
+  std::size_t num_chunks = 0;
+
+  /// The amount of destructors that were run by rewinding, resetting or
+  /// destroying the pool.
+  std::size_t num_destroyed = 0;
+
+  void add_in_use(std::size_t count) {
+    bytes_in_use += count;
+    high_water_mark = std::max(high_water_mark, bytes_in_use);
+  }
+
+  void transform(transformer& t) {
+    auto obj = t.transform_object("pool_stats");
+    obj.transform_field("bytes_requested", bytes_requested);
+    obj.transform_field("bytes_reserved", bytes_reserved);
+    obj.transform_field("bytes_padding", bytes_padding);
+    obj.transform_field("bytes_headers", bytes_headers);
+    obj.transform_field("bytes_in_use", bytes_in_use);
+    obj.transform_field("high_water_mark", high_water_mark);
+    obj.transform_field("num_allocations", num_allocations);
+    obj.transform_field("num_chunks", num_chunks);
+    obj.transform_field("num_destroyed", num_destroyed);
+    obj.finalize();
+  }
+
+};
+
+/// Get @p sz bytes of uninitialized memory for a pool chunk.
+///
+/// If the memory cannot be mapped, it is allocated with `new` instead and
+/// @p backing is set to @ref pool_backing::heap.
+///
+/// @throws std::bad_alloc if no memory could be allocated at all.
+std::byte* allocate_pool_chunk(std::size_t sz, pool_backing& backing);
+
+/// Release memory that was obtained with @ref allocate_pool_chunk.
+void free_pool_chunk(std::byte* ptr, std::size_t sz, pool_backing backing) noexcept;
+
 /// @brief A chunk of memory for storing variable-width objects which get destroyed all
 /// at once.
 ///
@@ -32,17 +124,26 @@ ZEN_NAMESPACE_START
 /// track of the free space at the end. The pointer is bumped with each
 /// allocation, hence the name.
 ///
+/// Objects that need to be destroyed are preceded by a small header that
+/// links them together and that points to their destructor. Memory that is
+/// requested without a destructor, such as for trivially destructible objects,
+/// has no header at all.
+///
 /// @see construct
 /// @see DynamicAllocator
 /// @see growing_bump_ptr_pool
 class bump_ptr_pool {
 
   std::size_t _data_sz;
+  pool_backing _backing;
 
   std::byte* _data_start;
   std::byte* _data_end;
+  std::byte* _first_slot = nullptr;
   std::byte* _prev_slot = nullptr;
 
+  pool_stats* _stats = nullptr;
+
   std::byte* get_slot_next_at(const std::byte* ptr) {
     std::byte* out;
     std::memcpy(&out, ptr, sizeof(void*));
@@ -67,17 +168,69 @@ class bump_ptr_pool {
     std::memcpy(ptr + sizeof(void*), &fn, sizeof(destroy_fn));
   }
 
-  std::byte* first_slot() {
-    return _data_end == _data_start ? nullptr : _data_start;
+  /// Run the destructors of @p slot and every slot that follows it.
+  void destroy_slots_from(std::byte* slot) {
+    std::size_t count = 0;
+    while (slot) {
+      get_slot_destroy_at(slot)(get_slot_data_at(slot));
+      slot = get_slot_next_at(slot);
+      ++count;
+    }
+    if (_stats) {
+      _stats->num_destroyed += count;
+    }
+  }
+
+  void record_allocation(std::byte* old_end, std::size_t sz, std::size_t header_size) {
+    auto used = static_cast<std::size_t>(_data_end - old_end);
+    ++_stats->num_allocations;
+    _stats->bytes_requested += sz;
+    _stats->bytes_headers += header_size;
+    _stats->bytes_padding += used - sz - header_size;
+    _stats->add_in_use(used);
   }
 
 public:
 
-  bump_ptr_pool(std::size_t sz = ZEN_DEFAULT_POOL_CHUNK_SIZE) {
-    _data_sz = sz;
-    _data_start = new std::byte[_data_sz + sizeof(void*)];
-    memset(_data_start, 0, _data_sz + sizeof(void*));
-    _data_end = _data_start;
+  /// A position in a pool that it can be rewound to.
+  ///
+  /// @see mark
+  /// @see rewind
+  struct marker {
+    std::byte* data_end;
+    std::byte* prev_slot;
+  };
+
+  /// Create a pool of @p sz bytes.
+  ///
+  /// The memory is not touched until objects are allocated in it.
+  bump_ptr_pool(std::size_t sz = ZEN_DEFAULT_POOL_CHUNK_SIZE, pool_backing backing = pool_backing::heap):
+    _data_sz(sz), _backing(backing) {
+      _data_start = allocate_pool_chunk(_data_sz, _backing);
+      _data_end = _data_start;
+    }
+
+  bump_ptr_pool(const bump_ptr_pool&) = delete;
+  bump_ptr_pool& operator=(const bump_ptr_pool&) = delete;
+
+  /// Start counting allocations in @p stats, or stop counting if it is
+  /// `nullptr`.
+  ///
+  /// Counting starts with the capacity of this pool and the bytes that are
+  /// already in use. Apart from @ref pool_stats::bytes_in_use, counters are
+  /// never decremented.
+  void set_stats(pool_stats* stats) {
+    _stats = stats;
+    if (_stats) {
+      _stats->bytes_reserved += _data_sz;
+      _stats->add_in_use(_data_end - _data_start);
+      ++_stats->num_chunks;
+    }
+  }
+
+  /// Get where the memory of this pool actually came from.
+  pool_backing backing() const {
+    return _backing;
   }
 
   bool empty() const {
@@ -100,28 +253,93 @@ public:
     if (!std::align(alignment, sz, data, free)) {
       return nullptr;
     }
-    set_slot_destroy_at(_data_end, destroy);
+    // The header goes right in front of the data, which may have been moved
+    // forward to satisfy the alignment.
+    auto slot = static_cast<std::byte*>(data) - sizeof(void*) - sizeof(destroy_fn);
+    set_slot_next_at(slot, nullptr);
+    set_slot_destroy_at(slot, destroy);
     if (_prev_slot) {
-      set_slot_next_at(_prev_slot, _data_end);
+      set_slot_next_at(_prev_slot, slot);
+    } else {
+      _first_slot = slot;
     }
-    _prev_slot = _data_end;
+    _prev_slot = slot;
+    auto old_end = _data_end;
     _data_end = static_cast<std::byte*>(data) + sz;
+    if (ZEN_UNLIKELY(_stats != nullptr)) {
+      record_allocation(old_end, sz, sizeof(void*) + sizeof(destroy_fn));
+    }
     return data;
   }
 
+  /// Allocate memory for an object that does not need to be destroyed.
+  ///
+  /// No header is written in front of the memory, so it takes up exactly
+  /// @p sz bytes plus any padding that is needed for @p alignment.
+  void* allocate(std::size_t sz, std::size_t alignment) {
+    void* data = _data_end;
+    std::size_t free = _data_sz - (_data_end - _data_start);
+    if (!std::align(alignment, sz, data, free)) {
+      return nullptr;
+    }
+    auto old_end = _data_end;
+    _data_end = static_cast<std::byte*>(data) + sz;
+    if (ZEN_UNLIKELY(_stats != nullptr)) {
+      record_allocation(old_end, sz, 0);
+    }
+    return data;
+  }
+
+  /// Get the current position of this pool, so that everything that is
+  /// allocated afterwards can be released with @ref rewind.
+  marker mark() const {
+    return marker { _data_end, _prev_slot };
+  }
+
+  /// Destroy every object that was allocated after @p m was obtained and make
+  /// its memory available again.
+  ///
+  /// Objects are destroyed in the order they were allocated in. The marker
+  /// must have been obtained from this pool, and the pool must not have been
+  /// rewound to a position before it in the meantime.
+  void rewind(const marker& m) {
+    if (m.prev_slot) {
+      destroy_slots_from(get_slot_next_at(m.prev_slot));
+      set_slot_next_at(m.prev_slot, nullptr);
+    } else {
+      destroy_slots_from(_first_slot);
+      _first_slot = nullptr;
+    }
+    _prev_slot = m.prev_slot;
+    if (_stats) {
+      _stats->bytes_in_use -= _data_end - m.data_end;
+    }
+    _data_end = m.data_end;
+  }
+
+  /// Destroy every object in this pool while keeping its memory.
+  void reset() {
+    rewind(marker { _data_start, nullptr });
+  }
+
   ~bump_ptr_pool() {
-    auto curr_slot = first_slot();
-    while (curr_slot) {
-      get_slot_destroy_at(curr_slot)(get_slot_data_at(reinterpret_cast<std::byte*>(curr_slot)));
-      curr_slot = get_slot_next_at(curr_slot);
+    destroy_slots_from(_first_slot);
+    if (_stats) {
+      _stats->bytes_in_use -= _data_end - _data_start;
     }
-    delete _data_start;
+    free_pool_chunk(_data_start, _data_sz, _backing);
   }
 
   static std::size_t min_size_for(std::size_t sz) {
     return power_of_2_ceil(sz + sizeof(void*) + sizeof(destroy_fn));
   }
 
+  /// The smallest chunk size that fits an object of size @p sz with the given
+  /// alignment and without a header.
+  static std::size_t min_size_for(std::size_t sz, std::size_t alignment) {
+    return power_of_2_ceil(sz + alignment);
+  }
+
 };
 
 /// @brief A growing collection of memory chunks for storing variable-width objects
@@ -138,34 +356,114 @@ public:
 /// @see bump_ptr_pool
 class growing_bump_ptr_pool {
 
-  std::list<bump_ptr_pool*> chunks;
+  std::vector<bump_ptr_pool*> chunks;
 
-public:
+  pool_backing backing;
 
-  growing_bump_ptr_pool(std::size_t min_size = ZEN_DEFAULT_GROWING_BUMP_PTR_POOL_MIN_SIZE) {
-    chunks.push_back(new bump_ptr_pool { power_of_2_ceil(min_size) });
-  }
+  pool_stats* stats = nullptr;
 
-  growing_bump_ptr_pool(growing_bump_ptr_pool&& other):
-    chunks(std::move(other.chunks)) {}
+  /// The chunk that is being allocated from. Chunks after it are empty and
+  /// are reused before any new chunk is allocated.
+  std::size_t current = 0;
 
-  void* allocate(std::size_t sz, std::size_t alignment, destroy_fn destroy) {
-    auto last_chunk = chunks.back();
-    void* ptr = last_chunk->allocate(sz, alignment, destroy);
-    if (ZEN_LIKELY(ptr)) {
-      return ptr;
+  template<typename ...Ts>
+  void* allocate_slow(std::size_t min_size, std::size_t sz, std::size_t alignment, Ts ...destroy) {
+    while (current + 1 < chunks.size()) {
+      ++current;
+      auto ptr = chunks[current]->allocate(sz, alignment, destroy...);
+      if (ptr) {
+        return ptr;
+      }
     }
     auto next_chunk = new (std::nothrow) bump_ptr_pool {
-      std::max(
-        bump_ptr_pool::min_size_for(sz),
-        next_power_of_2(last_chunk->capacity())
-      )
+      std::max<std::size_t>(min_size, next_power_of_2(chunks.back()->capacity())),
+      backing
     };
     if (ZEN_UNLIKELY(next_chunk == nullptr)) {
       return nullptr;
     }
+    next_chunk->set_stats(stats);
     chunks.push_back(next_chunk);
-    return next_chunk->allocate(sz, alignment, destroy);
+    current = chunks.size() - 1;
+    return next_chunk->allocate(sz, alignment, destroy...);
+  }
+
+public:
+
+  /// A position in a pool that it can be rewound to.
+  ///
+  /// @see mark
+  /// @see rewind
+  struct marker {
+    std::size_t chunk;
+    bump_ptr_pool::marker inner;
+  };
+
+  growing_bump_ptr_pool(std::size_t min_size = ZEN_DEFAULT_GROWING_BUMP_PTR_POOL_MIN_SIZE, pool_backing backing = pool_backing::heap):
+    backing(backing) {
+      chunks.push_back(new bump_ptr_pool { power_of_2_ceil(min_size), backing });
+    }
+
+  growing_bump_ptr_pool(growing_bump_ptr_pool&& other):
+    chunks(std::move(other.chunks)), backing(other.backing), stats(other.stats), current(other.current) {}
+
+  /// Start counting allocations in @p stats, or stop counting if it is
+  /// `nullptr`.
+  ///
+  /// @see bump_ptr_pool::set_stats
+  void set_stats(pool_stats* new_stats) {
+    stats = new_stats;
+    for (auto chunk: chunks) {
+      chunk->set_stats(stats);
+    }
+  }
+
+  void* allocate(std::size_t sz, std::size_t alignment, destroy_fn destroy) {
+    void* ptr = chunks[current]->allocate(sz, alignment, destroy);
+    if (ZEN_LIKELY(ptr)) {
+      return ptr;
+    }
+    return allocate_slow(bump_ptr_pool::min_size_for(sz), sz, alignment, destroy);
+  }
+
+  /// Allocate memory for an object that does not need to be destroyed.
+  ///
+  /// @see bump_ptr_pool::allocate(std::size_t, std::size_t)
+  void* allocate(std::size_t sz, std::size_t alignment) {
+    void* ptr = chunks[current]->allocate(sz, alignment);
+    if (ZEN_LIKELY(ptr)) {
+      return ptr;
+    }
+    return allocate_slow(bump_ptr_pool::min_size_for(sz, alignment), sz, alignment);
+  }
+
+  /// Get the current position of this pool, so that everything that is
+  /// allocated afterwards can be released with @ref rewind.
+  marker mark() const {
+    return marker { current, chunks[current]->mark() };
+  }
+
+  /// Destroy every object that was allocated after @p m was obtained.
+  ///
+  /// All chunks are kept, so that allocations after the rewind reuse them
+  /// instead of requesting new memory. Newer chunks are emptied before older
+  /// ones.
+  ///
+  /// @see bump_ptr_pool::rewind
+  void rewind(const marker& m) {
+    for (auto i = current; i > m.chunk; --i) {
+      chunks[i]->reset();
+    }
+    chunks[m.chunk]->rewind(m.inner);
+    current = m.chunk;
+  }
+
+  /// Destroy every object in this pool while keeping all of its chunks.
+  void reset() {
+    for (auto i = current + 1; i-- > 0;) {
+      chunks[i]->reset();
+    }
+    current = 0;
   }
 
   ~growing_bump_ptr_pool() {
@@ -175,6 +473,164 @@ public:
   }
 };
 
+/// @brief A collection of memory chunks that can be shared between threads.
+///
+/// Threads do not allocate from this pool directly. Instead, every thread
+/// creates its own @ref thread_local_pool, which claims a whole chunk at a
+/// time and then allocates from it without any synchronisation. Claiming a
+/// chunk only takes a few atomic operations on lock-free lists.
+///
+/// All objects are destroyed when this pool is destroyed, which must not
+/// happen while another thread is still using it.
+///
+/// ```
+/// zen::concurrent_bump_ptr_pool shared;
+/// // Inside every worker thread
+/// zen::thread_local_pool pool { shared };
+/// auto node = zen::construct<ast_node>(pool);
+/// ```
+///
+/// @see thread_local_pool
+class concurrent_bump_ptr_pool {
+
+  struct chunk {
+    bump_ptr_pool pool;
+    /// Each list has its own link, so that a thread that pushes a chunk it
+    /// just popped onto @ref used_chunks does not overwrite the link that
+    /// another thread may still be reading in @ref pop.
+    chunk* free_next = nullptr;
+    chunk* used_next = nullptr;
+    chunk(std::size_t size, pool_backing backing): pool(size, backing) {}
+  };
+
+  std::size_t chunk_size;
+  pool_backing backing;
+
+  /// Chunks that were allocated up front and that no thread owns yet.
+  ///
+  /// Chunks are only ever popped from this list while the pool is in use,
+  /// so a chunk that was popped cannot reappear at the head and popping does
+  /// not suffer from the ABA problem.
+  std::atomic<chunk*> free_chunks = nullptr;
+
+  /// Chunks that were handed out to a thread.
+  std::atomic<chunk*> used_chunks = nullptr;
+
+  using link = chunk* chunk::*;
+
+  static void push(std::atomic<chunk*>& list, link next, chunk* c) {
+    auto head = list.load(std::memory_order_relaxed);
+    do {
+      c->*next = head;
+    } while (!list.compare_exchange_weak(head, c, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  static chunk* pop(std::atomic<chunk*>& list, link next) {
+    auto head = list.load(std::memory_order_acquire);
+    while (head != nullptr && !list.compare_exchange_weak(head, head->*next, std::memory_order_acquire, std::memory_order_acquire));
+    return head;
+  }
+
+  static void destroy_list(chunk* c, link next_link) {
+    while (c != nullptr) {
+      auto next = c->*next_link;
+      delete c;
+      c = next;
+    }
+  }
+
+public:
+
+  concurrent_bump_ptr_pool(std::size_t chunk_size = ZEN_DEFAULT_POOL_CHUNK_SIZE, pool_backing backing = pool_backing::heap):
+    chunk_size(chunk_size), backing(backing) {}
+
+  concurrent_bump_ptr_pool(const concurrent_bump_ptr_pool&) = delete;
+  concurrent_bump_ptr_pool& operator=(const concurrent_bump_ptr_pool&) = delete;
+
+  std::size_t get_chunk_size() const {
+    return chunk_size;
+  }
+
+  /// Allocate @p count chunks up front so that threads do not have to call
+  /// into the system allocator when they run out of memory.
+  void reserve(std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      push(free_chunks, &chunk::free_next, new chunk { chunk_size, backing });
+    }
+  }
+
+  /// Get a chunk of at least @p min_size bytes that is owned exclusively by
+  /// the calling thread. It remains part of this pool.
+  ///
+  /// @return The chunk or `nullptr` if no memory could be allocated.
+  bump_ptr_pool* acquire_chunk(std::size_t min_size) {
+    chunk* c = nullptr;
+    if (ZEN_LIKELY(min_size <= chunk_size)) {
+      c = pop(free_chunks, &chunk::free_next);
+    }
+    if (c == nullptr) {
+      c = new (std::nothrow) chunk { std::max(min_size, chunk_size), backing };
+      if (ZEN_UNLIKELY(c == nullptr)) {
+        return nullptr;
+      }
+    }
+    push(used_chunks, &chunk::used_next, c);
+    return &c->pool;
+  }
+
+  ~concurrent_bump_ptr_pool() {
+    destroy_list(used_chunks.load(std::memory_order_acquire), &chunk::used_next);
+    destroy_list(free_chunks.load(std::memory_order_acquire), &chunk::free_next);
+  }
+
+};
+
+/// @brief A handle to a @ref concurrent_bump_ptr_pool for use by one thread.
+///
+/// This is a @ref DynamicAllocator, so it can be passed to @ref construct. It
+/// must only be used by the thread that created it. Objects that were
+/// allocated through it live until the shared pool is destroyed, so the
+/// handle itself may be destroyed at any time.
+class thread_local_pool {
+
+  concurrent_bump_ptr_pool& shared;
+  bump_ptr_pool* current = nullptr;
+
+  template<typename ...Ts>
+  void* allocate_impl(std::size_t sz, std::size_t alignment, Ts ...destroy) {
+    if (ZEN_LIKELY(current != nullptr)) {
+      auto ptr = current->allocate(sz, alignment, destroy...);
+      if (ZEN_LIKELY(ptr)) {
+        return ptr;
+      }
+    }
+    auto next = shared.acquire_chunk(bump_ptr_pool::min_size_for(sz + alignment));
+    if (ZEN_UNLIKELY(next == nullptr)) {
+      return nullptr;
+    }
+    current = next;
+    return current->allocate(sz, alignment, destroy...);
+  }
+
+public:
+
+  explicit thread_local_pool(concurrent_bump_ptr_pool& shared):
+    shared(shared) {}
+
+  thread_local_pool(const thread_local_pool&) = delete;
+  thread_local_pool& operator=(const thread_local_pool&) = delete;
+
+  void* allocate(std::size_t sz, std::size_t alignment, destroy_fn destroy) {
+    return allocate_impl(sz, alignment, destroy);
+  }
+
+  /// Allocate memory for an object that does not need to be destroyed.
+  void* allocate(std::size_t sz, std::size_t alignment) {
+    return allocate_impl(sz, alignment);
+  }
+
+};
+
 ZEN_NAMESPACE_END
 
 #endif // of #ifndef ZEN_BUMP_PTR_POOL_HPP
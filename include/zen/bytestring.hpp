@@ -10,6 +10,7 @@
 
 #include "zen/config.hpp"
 #include "zen/algorithm.hpp"
+#include "zen/hash.hpp"
 #include "zen/zip_iterator.hpp"
 #include "zen/iterator_range.hpp"
 
@@ -45,6 +46,9 @@ public:
   const char* ptr;
   const std::size_t sz;
 
+  bytestring_view(const char* ptr, std::size_t sz) ZEN_NOEXCEPT:
+    ptr(ptr), sz(sz) {}
+
   template<typename BS>
   bytestring_view(const BS& data) ZEN_NOEXCEPT:
     ptr(data.ptr), sz(data.sz) {}
@@ -133,7 +137,7 @@ public:
       if (ptr == nullptr) {
         ZEN_PANIC("insufficient memory");
       }
-      max_sz = max_sz;
+      this->max_sz = max_sz;
     }
 
   basic_bytestring() ZEN_NOEXCEPT:
@@ -234,10 +238,29 @@ public:
     return std::string(ptr, sz);
   }
 
+  /// Change the size of this string without touching its contents.
+  ///
+  /// When growing, the new characters must have been written through
+  /// @ref data() beforehand.
   void resize(std::size_t new_sz) ZEN_NOEXCEPT{
-    ZEN_ASSERT(new_sz <= sz);
+    ZEN_ASSERT(new_sz <= max_sz);
     sz = new_sz;
-    ptr[new_sz] = '\0';
+    if (new_sz < max_sz) {
+      ptr[new_sz] = '\0';
+    }
+  }
+
+  /// Make room for at least @p new_max_sz characters.
+  void reserve(std::size_t new_max_sz) ZEN_NOEXCEPT {
+    if (new_max_sz <= max_sz) {
+      return;
+    }
+    auto new_ptr = static_cast<char*>(realloc(ptr, new_max_sz));
+    if (new_ptr == nullptr) {
+      ZEN_PANIC("insufficient memory");
+    }
+    ptr = new_ptr;
+    max_sz = new_max_sz;
   }
 
   ~basic_bytestring() ZEN_NOEXCEPT {
@@ -258,20 +281,23 @@ using bytestring = basic_bytestring<>;
 
 ZEN_NAMESPACE_END
 
-namespace std {
+ZEN_NAMESPACE_START
 
-  template<std::size_t N>
-  struct hash<zen::basic_bytestring<N>> {
+template<std::size_t N>
+struct hash<basic_bytestring<N>> {
 
-    std::size_t operator()(const zen::basic_bytestring<N> str) const noexcept {
-      std::size_t h = 17;
-      for (auto ch: str) {
-        h = h * 19 + ch;
-      }
-      return h;
-    }
+  std::size_t operator()(const basic_bytestring<N>& str) const noexcept {
+    return hash_bytes(str.data(), str.size());
+  }
+
+};
 
-  };
+ZEN_NAMESPACE_END
+
+namespace std {
+
+  template<std::size_t N>
+  struct hash<zen::basic_bytestring<N>> : zen::hash<zen::basic_bytestring<N>> {};
 
 }
 
@@ -1,6 +1,9 @@
 #ifndef ZEN_FS_FILE_HPP
 #define ZEN_FS_FILE_HPP
 
+#include <string_view>
+#include <utility>
+
 #include "zen/either.hpp"
 #include "zen/bytestring.hpp"
 #include "zen/fs/path.hpp"
@@ -9,7 +12,102 @@ ZEN_NAMESPACE_START
 
 namespace fs {
 
-either<std::error_code, bytestring> read_file(const path& filename); 
+/// The amount of bytes that @ref read_file asks for in one system call by
+/// default.
+#define ZEN_DEFAULT_READ_FILE_BLOCK_SIZE (1024 * 1024)
+
+struct read_file_opts {
+
+  /// The maximum amount of bytes to read in one system call.
+  std::size_t block_size = ZEN_DEFAULT_READ_FILE_BLOCK_SIZE;
+
+  /// Tell the kernel that the file will be read from front to back, so that
+  /// it reads ahead more aggressively.
+  bool sequential = true;
+
+};
+
+/// Read the entire contents of a file into memory.
+///
+/// The contents are read directly into the string that is returned, without
+/// going through an intermediate buffer. Files that grow or shrink while
+/// they are being read are handled gracefully: the result contains whatever
+/// was read until the end of the file was reached.
+either<std::error_code, bytestring> read_file(const path& filename, read_file_opts opts = {});
+
+struct map_file_opts {
+
+  /// Tell the kernel that the file will be read from front to back, so that
+  /// it reads ahead aggressively and drops pages that were already read.
+  bool sequential = true;
+
+  /// Ask the kernel to start reading the whole file into memory right away.
+  bool will_need = false;
+
+};
+
+/// A read-only view of a file that was mapped into memory.
+///
+/// The mapping is released when this object is destroyed. Views that were
+/// obtained from it must not be used afterwards.
+///
+/// @see map_file
+class mapped_file {
+
+  friend either<std::error_code, mapped_file> map_file(const path& filename, map_file_opts opts);
+
+  const char* ptr = nullptr;
+  std::size_t sz = 0;
+
+  mapped_file(const char* ptr, std::size_t sz):
+    ptr(ptr), sz(sz) {}
+
+public:
+
+  mapped_file() = default;
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  mapped_file(mapped_file&& other) noexcept:
+    ptr(std::exchange(other.ptr, nullptr)), sz(std::exchange(other.sz, 0)) {}
+
+  mapped_file& operator=(mapped_file&& other) noexcept {
+    std::swap(ptr, other.ptr);
+    std::swap(sz, other.sz);
+    return *this;
+  }
+
+  const char* data() const {
+    return ptr;
+  }
+
+  std::size_t size() const {
+    return sz;
+  }
+
+  bool empty() const {
+    return sz == 0;
+  }
+
+  std::string_view as_string_view() const {
+    return { ptr, sz };
+  }
+
+  bytestring_view as_bytestring_view() const {
+    return { ptr, sz };
+  }
+
+  ~mapped_file();
+
+};
+
+/// Map the contents of a file into memory without copying them.
+///
+/// Pages are read from the page cache on demand and are shared with every
+/// other process that maps or reads the same file. An empty file results in
+/// an empty mapping.
+either<std::error_code, mapped_file> map_file(const path& filename, map_file_opts opts = {});
 
 }
 
@@ -1,6 +1,159 @@
+/// @file
+/// @brief Fast, well-distributed hash functions.
+///
+/// @ref hash_bytes consumes its input eight bytes at a time and folds every
+/// pair of words with a full 64x64 to 128-bit multiplication, in the style of
+/// wyhash. Inputs that are not a multiple of eight bytes long are finished
+/// with overlapping word loads instead of a loop over the remaining bytes.
+///
+/// @ref hash is a drop-in replacement for `std::hash` that uses these
+/// functions for strings and integers. Strings are hashed through a view, so
+/// a `std::string`, a `std::string_view` and a C string with the same
+/// characters all have the same hash.
 
+#ifndef ZEN_HASH_HPP
+#define ZEN_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "zen/config.hpp"
+
+ZEN_NAMESPACE_START
+
+constexpr std::uint64_t hash_secret[4] = {
+  0x2d358dccaa6c78a5ull,
+  0x8bb84b93962eacc9ull,
+  0x4b33a62ed433d4a3ull,
+  0x4d5a2da51de1aa47ull,
+};
+
+/// Multiply two words and fold the 128-bit product back into one word.
+inline std::uint64_t hash_mix(std::uint64_t a, std::uint64_t b) noexcept {
+  auto r = static_cast<unsigned __int128>(a) * b;
+  return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+}
+
+inline std::uint64_t hash_read8(const unsigned char* ptr) noexcept {
+  std::uint64_t x;
+  std::memcpy(&x, ptr, 8);
+  return x;
+}
+
+inline std::uint64_t hash_read4(const unsigned char* ptr) noexcept {
+  std::uint32_t x;
+  std::memcpy(&x, ptr, 4);
+  return x;
+}
+
+/// Hash @p size bytes starting at @p data.
+inline std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed = 0) noexcept {
+
+  auto ptr = static_cast<const unsigned char*>(data);
+  seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+  std::uint64_t a;
+  std::uint64_t b;
+
+  if (ZEN_LIKELY(size <= 16)) {
+    if (size >= 4) {
+      // Two pairs of possibly overlapping 4-byte loads cover every byte.
+      auto offset = (size >> 3) << 2;
+      a = (hash_read4(ptr) << 32) | hash_read4(ptr + offset);
+      b = (hash_read4(ptr + size - 4) << 32) | hash_read4(ptr + size - 4 - offset);
+    } else if (size > 0) {
+      a = (static_cast<std::uint64_t>(ptr[0]) << 16)
+        | (static_cast<std::uint64_t>(ptr[size >> 1]) << 8)
+        | ptr[size - 1];
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    auto left = size;
+    if (ZEN_UNLIKELY(left > 48)) {
+      // Three independent lanes keep the multipliers busy on long inputs.
+      auto seed1 = seed;
+      auto seed2 = seed;
+      do {
+        seed = hash_mix(hash_read8(ptr) ^ hash_secret[1], hash_read8(ptr + 8) ^ seed);
+        seed1 = hash_mix(hash_read8(ptr + 16) ^ hash_secret[2], hash_read8(ptr + 24) ^ seed1);
+        seed2 = hash_mix(hash_read8(ptr + 32) ^ hash_secret[3], hash_read8(ptr + 40) ^ seed2);
+        ptr += 48;
+        left -= 48;
+      } while (left > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (left > 16) {
+      seed = hash_mix(hash_read8(ptr) ^ hash_secret[1], hash_read8(ptr + 8) ^ seed);
+      ptr += 16;
+      left -= 16;
+    }
+    // The last 16 bytes, which may overlap with bytes that were already
+    // consumed.
+    a = hash_read8(ptr + left - 16);
+    b = hash_read8(ptr + left - 8);
+  }
+
+  a ^= hash_secret[1];
+  b ^= seed;
+  auto r = static_cast<unsigned __int128>(a) * b;
+  a = static_cast<std::uint64_t>(r);
+  b = static_cast<std::uint64_t>(r >> 64);
+  return hash_mix(a ^ hash_secret[0] ^ size, b ^ hash_secret[1]);
+}
+
+/// Hash a single word.
+inline std::uint64_t hash_integer(std::uint64_t x, std::uint64_t seed = 0) noexcept {
+  return hash_mix(x ^ seed ^ hash_secret[0], hash_mix(x ^ hash_secret[1], hash_secret[2]));
+}
+
+/// Hashes strings of characters through a view, so that it can be used to
+/// look up `std::string` keys with a `std::string_view` or a C string.
+struct string_hash {
+
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view str) const noexcept {
+    return hash_bytes(str.data(), str.size());
+  }
+
+};
+
+/// Hashes a value of type @p T.
+///
+/// Integers, enumerations, pointers and anything that converts to a
+/// `std::string_view` are hashed by Zen++ itself. Other types fall back to
+/// `std::hash`.
+template<typename T>
+struct hash {
+
+  std::size_t operator()(const T& value) const {
+    if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+      return hash_integer(static_cast<std::uint64_t>(value));
+    } else if constexpr (std::is_pointer_v<T>) {
+      return hash_integer(reinterpret_cast<std::uintptr_t>(value));
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+      return string_hash{}(value);
+    } else {
+      return std::hash<T>{}(value);
+    }
+  }
+
+};
+
+template<typename Alloc>
+struct hash<std::basic_string<char, std::char_traits<char>, Alloc>> : string_hash {};
+
+template<>
+struct hash<std::string_view> : string_hash {};
+
+ZEN_NAMESPACE_END
 
 namespace std {
 
@@ -10,16 +163,12 @@ namespace std {
     typename Allocator
   > struct hash<std::basic_string<CharT, Traits, Allocator>> {
 
-    std::size_t operator()(const std::basic_string<CharT, Traits, Allocator> str) const noexcept {
-      std::size_t h = 17;
-      for (auto ch: str) {
-        h = h * 19 + ch;
-      }
-      return h;
+    std::size_t operator()(const std::basic_string<CharT, Traits, Allocator>& str) const noexcept {
+      return ::ZEN_NAMESPACE::hash_bytes(str.data(), str.size() * sizeof(CharT));
     }
 
   };
 
 }
 
-
+#endif // of #ifndef ZEN_HASH_HPP
@@ -1,164 +1,651 @@
+/// @file
+/// @brief An open-addressing hash table in the style of Swiss tables.
+///
+/// Every slot of a @ref hash_index has a matching control byte that is either
+/// empty, deleted or holds seven bits of the hash of the element in the slot.
+/// A lookup compares a whole group of control bytes at once, so most probes
+/// touch a single cache line of control bytes and at most one element.
+
 #ifndef ZEN_HASHINDEX_HPP
 #define ZEN_HASHINDEX_HPP
 
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <type_traits>
-#include <vector>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "zen/config.hpp"
 #include "zen/hash.hpp"
 
 ZEN_NAMESPACE_START
 
-template<typename T, typename KeyT>
-using hash_bucket = std::vector<T>;
+/// The amount of control bytes that are compared at once.
+#define ZEN_HASH_INDEX_GROUP_WIDTH 16
 
-template<
-  typename T,
-  typename KeyT,
-  typename ReferenceT,
-  typename BucketT
->
+/// Key extractor that uses an element as its own key.
+struct identity_key {
+
+  template<typename T>
+  const T& operator()(const T& element) const noexcept {
+    return element;
+  }
+
+};
+
+constexpr std::int8_t hash_index_empty = -128;
+constexpr std::int8_t hash_index_deleted = -2;
+
+/// Spread the bits of a hash so that weak hash functions, such as the
+/// identity function that `std::hash` uses for integers, still result in
+/// evenly filled groups when they are passed in as @p HashT.
+inline std::size_t hash_index_mix(std::size_t h) noexcept {
+  auto m = static_cast<unsigned __int128>(h) * 0x9E3779B97F4A7C15ull;
+  return static_cast<std::size_t>(m) ^ static_cast<std::size_t>(m >> 64);
+}
+
+/// A group of control bytes that is loaded from memory at once.
+///
+/// Every match returns a mask with one bit per control byte, where the lowest
+/// bit corresponds to the first control byte.
+class hash_index_group {
+
+#ifdef __SSE2__
+  __m128i ctrl;
+#else
+  std::int8_t ctrl[ZEN_HASH_INDEX_GROUP_WIDTH];
+#endif
+
+public:
+
+  explicit hash_index_group(const std::int8_t* ptr) noexcept {
+#ifdef __SSE2__
+    ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+#else
+    std::memcpy(ctrl, ptr, ZEN_HASH_INDEX_GROUP_WIDTH);
+#endif
+  }
+
+  std::uint32_t match(std::int8_t h2) const noexcept {
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < ZEN_HASH_INDEX_GROUP_WIDTH; ++i) {
+      mask |= static_cast<std::uint32_t>(ctrl[i] == h2) << i;
+    }
+    return mask;
+#endif
+  }
+
+  std::uint32_t match_empty() const noexcept {
+    return match(hash_index_empty);
+  }
+
+  /// Match every control byte that does not refer to an element.
+  std::uint32_t match_free() const noexcept {
+#ifdef __SSE2__
+    return _mm_movemask_epi8(ctrl);
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < ZEN_HASH_INDEX_GROUP_WIDTH; ++i) {
+      mask |= static_cast<std::uint32_t>(ctrl[i] < 0) << i;
+    }
+    return mask;
+#endif
+  }
+
+};
+
+template<typename T>
 class hash_index_iterator {
 
-  BucketT& buckets;
-  std::size_t bucket_index;
-  std::size_t element_index;
+  template<typename T2, typename KeyT, typename Alloc, typename GetKeyT, typename HashT, typename EqualT>
+  friend class hash_index;
+
+  template<typename T2>
+  friend class hash_index_iterator;
+
+  const std::int8_t* ctrl;
+  T* slot;
+  T* end;
+
+  void skip_free() noexcept {
+    while (slot != end && *ctrl < 0) {
+      ++ctrl;
+      ++slot;
+    }
+  }
+
+public:
+
+  using value_type = std::remove_const_t<T>;
+  using reference = T&;
+  using pointer = T*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+  hash_index_iterator() = default;
+
+  hash_index_iterator(const std::int8_t* ctrl, T* slot, T* end) noexcept:
+    ctrl(ctrl), slot(slot), end(end) {}
 
+  /// Allow a mutable iterator to be converted to a const iterator.
+  template<typename T2>
+  requires (std::is_same_v<const T2, T> && !std::is_same_v<T2, T>)
+  hash_index_iterator(const hash_index_iterator<T2>& other) noexcept:
+    ctrl(other.ctrl), slot(other.slot), end(other.end) {}
+
+  reference operator*() const noexcept {
+    return *slot;
+  }
+
+  pointer operator->() const noexcept {
+    return slot;
+  }
+
+  hash_index_iterator& operator++() noexcept {
+    ++ctrl;
+    ++slot;
+    skip_free();
+    return *this;
+  }
+
+  hash_index_iterator operator++(int) noexcept {
+    auto copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  bool operator==(const hash_index_iterator& other) const noexcept {
+    return slot == other.slot;
+  }
+
+};
+
+/// A set of elements that can be looked up by a key that is extracted from
+/// them with @p GetKeyT.
+///
+/// Elements are stored in one flat array. When more than 7/8th of the slots
+/// are in use, the table doubles in size. Erased elements leave a tombstone
+/// behind unless no probe sequence can have passed over them, and tombstones
+/// are cleaned up the next time the table is rehashed.
+///
+/// Lookups accept any key type that @p HashT and @p EqualT accept, so
+/// transparent functors allow looking up elements without constructing a
+/// @p KeyT.
+template<
+  typename T,
+  typename KeyT = T,
+  typename Alloc = std::allocator<T>,
+  typename GetKeyT = identity_key,
+  typename HashT = hash<KeyT>,
+  typename EqualT = std::equal_to<KeyT>
+>
+class hash_index {
 public:
 
   using value_type = T;
-  using reference = ReferenceT;
-  using pointer = value_type*;
+  using key_type = KeyT;
+  using size_type = std::size_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using allocator_type = Alloc;
+  using iterator = hash_index_iterator<T>;
+  using const_iterator = hash_index_iterator<const T>;
+
+private:
+
+  using slot_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+  using slot_traits = std::allocator_traits<slot_alloc>;
+  using ctrl_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::int8_t>;
+  using ctrl_traits = std::allocator_traits<ctrl_alloc>;
+
+  static constexpr std::size_t group_width = ZEN_HASH_INDEX_GROUP_WIDTH;
+
+  [[no_unique_address]] GetKeyT get_key;
+  [[no_unique_address]] HashT hasher;
+  [[no_unique_address]] EqualT equal;
+  [[no_unique_address]] slot_alloc alloc;
+
+  /// One control byte per slot, followed by a copy of the first group so
+  /// that a group can be loaded at any position without wrapping around.
+  std::int8_t* ctrl = nullptr;
+  T* slots = nullptr;
+  std::size_t num_slots = 0;
+  std::size_t num_elements = 0;
+
+  /// The amount of elements that can be added before the table has to be
+  /// rehashed. Tombstones count as occupied slots.
+  std::size_t growth_left = 0;
+
+  static std::size_t max_load(std::size_t capacity) noexcept {
+    return capacity - capacity / 8;
+  }
+
+  static std::int8_t get_h2(std::size_t h) noexcept {
+    return static_cast<std::int8_t>(h & 0x7F);
+  }
 
-  inline hash_index_iterator(
-    BucketT& buckets,
-    std::size_t bucket_index,
-    std::size_t element_index
-  ): buckets(buckets),
-     bucket_index(bucket_index),
-     element_index(element_index) {}
+  void set_ctrl(std::size_t i, std::int8_t value) noexcept {
+    ctrl[i] = value;
+    if (i < group_width) {
+      ctrl[num_slots + i] = value;
+    }
+  }
 
-  value_type operator*() {
-    return buckets[bucket_index][element_index];
+  template<typename K>
+  std::size_t hash_key(const K& key) const {
+    return hash_index_mix(hasher(key));
   }
 
-  void operator++() {
+  /// Get the slot of the element with the given key or @ref num_slots if
+  /// there is no such element.
+  template<typename K>
+  std::size_t find_slot(const K& key, std::size_t h) const {
+    if (num_slots == 0) {
+      return 0;
+    }
+    const auto mask = num_slots - 1;
+    const auto h2 = get_h2(h);
+    auto pos = (h >> 7) & mask;
+    std::size_t step = 0;
     for (;;) {
-      if (bucket_index >= buckets.size()) {
-        break;
+      hash_index_group group { ctrl + pos };
+      for (auto match = group.match(h2); match != 0; match &= match - 1) {
+        auto i = (pos + __builtin_ctz(match)) & mask;
+        if (ZEN_LIKELY(equal(get_key(slots[i]), key))) {
+          return i;
+        }
       }
-      if (element_index >= buckets[bucket_index].size()) {
-        ++bucket_index;
-      } else {
-        ++element_index;
-      }
-      if (element_index < buckets[bucket_index].size()) {
-        break;
+      if (ZEN_LIKELY(group.match_empty() != 0)) {
+        return num_slots;
       }
+      step += group_width;
+      pos = (pos + step) & mask;
     }
   }
 
-  void operator--() {
+  /// Get the first slot that is empty or deleted in the probe sequence of
+  /// @p h. The table must not be full.
+  std::size_t find_free_slot(std::size_t h) const noexcept {
+    const auto mask = num_slots - 1;
+    auto pos = (h >> 7) & mask;
+    std::size_t step = 0;
     for (;;) {
-      if (element_index == 0) {
-        --bucket_index;
-        element_index = buckets[bucket_index].size();
-      } else {
-        --element_index;
+      hash_index_group group { ctrl + pos };
+      auto match = group.match_free();
+      if (match != 0) {
+        return (pos + __builtin_ctz(match)) & mask;
       }
-      if (element_index < buckets[bucket_index].size()) {
-        break;
+      step += group_width;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  void allocate_table(std::size_t capacity) {
+    ctrl_alloc a { alloc };
+    ctrl = ctrl_traits::allocate(a, capacity + group_width);
+    try {
+      slots = slot_traits::allocate(alloc, capacity);
+    } catch (...) {
+      ctrl_traits::deallocate(a, ctrl, capacity + group_width);
+      ctrl = nullptr;
+      throw;
+    }
+    std::memset(ctrl, static_cast<unsigned char>(hash_index_empty), capacity + group_width);
+    num_slots = capacity;
+    growth_left = max_load(capacity);
+  }
+
+  void deallocate_table() noexcept {
+    if (num_slots == 0) {
+      return;
+    }
+    for (std::size_t i = 0; i < num_slots; ++i) {
+      if (ctrl[i] >= 0) {
+        slot_traits::destroy(alloc, slots + i);
       }
     }
+    ctrl_alloc a { alloc };
+    ctrl_traits::deallocate(a, ctrl, num_slots + group_width);
+    slot_traits::deallocate(alloc, slots, num_slots);
+    ctrl = nullptr;
+    slots = nullptr;
+    num_slots = 0;
+    num_elements = 0;
+    growth_left = 0;
   }
 
-  bool operator==(const hash_index_iterator& other) const {
-    return bucket_index == other.bucket_index
-        && element_index == other.element_index;
+  /// Free the table of this index and take over the table of @p other,
+  /// which must have been allocated with an allocator that is equal to ours.
+  void take_table(hash_index& other) noexcept {
+    deallocate_table();
+    ctrl = std::exchange(other.ctrl, nullptr);
+    slots = std::exchange(other.slots, nullptr);
+    num_slots = std::exchange(other.num_slots, 0);
+    num_elements = std::exchange(other.num_elements, 0);
+    growth_left = std::exchange(other.growth_left, 0);
   }
 
-};
+  /// Move every element into a fresh table with @p capacity slots, dropping
+  /// all tombstones.
+  void rehash(std::size_t capacity) {
+    auto old_ctrl = ctrl;
+    auto old_slots = slots;
+    auto old_num_slots = num_slots;
+    allocate_table(capacity);
+    for (std::size_t i = 0; i < old_num_slots; ++i) {
+      if (old_ctrl[i] < 0) {
+        continue;
+      }
+      auto h = hash_key(get_key(old_slots[i]));
+      auto k = find_free_slot(h);
+      slot_traits::construct(alloc, slots + k, std::move(old_slots[i]));
+      slot_traits::destroy(alloc, old_slots + i);
+      set_ctrl(k, get_h2(h));
+    }
+    growth_left -= num_elements;
+    if (old_num_slots > 0) {
+      ctrl_alloc a { alloc };
+      ctrl_traits::deallocate(a, old_ctrl, old_num_slots + group_width);
+      slot_traits::deallocate(alloc, old_slots, old_num_slots);
+    }
+  }
 
-template<
-  typename T,
-  typename KeyT,
-  typename ReferenceT,
-  typename BucketT
->
-class const_hash_index_iterator : hash_index_iterator<const T, KeyT, const ReferenceT, const BucketT> {
+  /// Get a free slot for an element with hash @p h, growing the table or
+  /// cleaning up tombstones if needed.
+  std::size_t prepare_insert(std::size_t h) {
+    if (num_slots == 0) {
+      rehash(group_width);
+    }
+    auto i = find_free_slot(h);
+    if (ZEN_UNLIKELY(growth_left == 0 && ctrl[i] != hash_index_deleted)) {
+      // Only grow when the table is actually crowded; when a sizeable part of
+      // it is tombstones, rehashing at the same size is enough.
+      rehash(num_elements * 32 > num_slots * 25 ? num_slots * 2 : num_slots);
+      i = find_free_slot(h);
+    }
+    if (ctrl[i] == hash_index_empty) {
+      --growth_left;
+    }
+    return i;
+  }
 
-};
+  void erase_slot(std::size_t i) noexcept {
+    slot_traits::destroy(alloc, slots + i);
+    --num_elements;
+    // If the slot sits inside a run of fewer than group_width full or deleted
+    // slots, no probe can have continued past it, so it may become empty
+    // again instead of leaving a tombstone behind.
+    const auto mask = num_slots - 1;
+    auto empty_before = hash_index_group(ctrl + ((i - group_width) & mask)).match_empty();
+    auto empty_after = hash_index_group(ctrl + i).match_empty();
+    if (empty_before != 0 && empty_after != 0
+        && static_cast<std::size_t>((__builtin_clz(empty_before) - (32 - group_width)) + __builtin_ctz(empty_after)) < group_width) {
+      set_ctrl(i, hash_index_empty);
+      ++growth_left;
+    } else {
+      set_ctrl(i, hash_index_deleted);
+    }
+  }
 
-template<typename T, typename KeyT = T>
-class hash_index {
+  iterator make_iterator(std::size_t i) noexcept {
+    return iterator(ctrl + i, slots + i, slots + num_slots);
+  }
+
+  const_iterator make_iterator(std::size_t i) const noexcept {
+    return const_iterator(ctrl + i, slots + i, slots + num_slots);
+  }
 
-  using bucket = hash_bucket<T, KeyT>;
+public:
 
-  std::hash<KeyT> hasher;
+  explicit hash_index(
+    const Alloc& alloc = Alloc(),
+    GetKeyT get_key = GetKeyT(),
+    HashT hasher = HashT(),
+    EqualT equal = EqualT()
+  ): get_key(std::move(get_key)),
+     hasher(std::move(hasher)),
+     equal(std::move(equal)),
+     alloc(alloc) {}
+
+  hash_index(const hash_index& other):
+    hash_index(other, slot_traits::select_on_container_copy_construction(other.alloc)) {}
+
+  /// Copy @p other into a table whose slots are allocated using @p alloc.
+  hash_index(const hash_index& other, const Alloc& new_alloc):
+    get_key(other.get_key),
+    hasher(other.hasher),
+    equal(other.equal),
+    alloc(new_alloc) {
+      if (other.num_slots == 0) {
+        return;
+      }
+      // Elements keep their slots, so nothing needs to be hashed again.
+      allocate_table(other.num_slots);
+      std::memcpy(ctrl, other.ctrl, num_slots + group_width);
+      for (std::size_t i = 0; i < num_slots; ++i) {
+        if (ctrl[i] >= 0) {
+          slot_traits::construct(alloc, slots + i, other.slots[i]);
+          ++num_elements;
+        }
+      }
+      growth_left = other.growth_left;
+    }
 
-  std::vector<bucket> buckets;
+  hash_index(hash_index&& other) noexcept:
+    get_key(std::move(other.get_key)),
+    hasher(std::move(other.hasher)),
+    equal(std::move(other.equal)),
+    alloc(std::move(other.alloc)),
+    ctrl(std::exchange(other.ctrl, nullptr)),
+    slots(std::exchange(other.slots, nullptr)),
+    num_slots(std::exchange(other.num_slots, 0)),
+    num_elements(std::exchange(other.num_elements, 0)),
+    growth_left(std::exchange(other.growth_left, 0)) {}
+
+  /// Copy @p other into this index.
+  ///
+  /// The allocator of @p other is only adopted if it propagates on copy
+  /// assignment. Otherwise, the elements are copied into memory from the
+  /// allocator of this index.
+  hash_index& operator=(const hash_index& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (slot_traits::propagate_on_container_copy_assignment::value) {
+      hash_index copy { other, other.alloc };
+      deallocate_table();
+      alloc = other.alloc;
+      take_table(copy);
+    } else {
+      hash_index copy { other, alloc };
+      take_table(copy);
+    }
+    get_key = other.get_key;
+    hasher = other.hasher;
+    equal = other.equal;
+    return *this;
+  }
 
-  const KeyT& get_key(const T& element) {
-    // FIXME This needs to be generalized
-    return element->first;
+  /// Move the elements of @p other into this index.
+  ///
+  /// If the allocator does not propagate on move assignment and the two
+  /// allocators are not equal, the elements are copied into memory from the
+  /// allocator of this index instead.
+  hash_index& operator=(hash_index&& other) noexcept(
+    slot_traits::propagate_on_container_move_assignment::value
+    || slot_traits::is_always_equal::value
+  ) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (slot_traits::propagate_on_container_move_assignment::value) {
+      deallocate_table();
+      alloc = std::move(other.alloc);
+      take_table(other);
+    } else if (alloc == other.alloc) {
+      take_table(other);
+    } else {
+      hash_index copy { other, alloc };
+      take_table(copy);
+      other.deallocate_table();
+    }
+    get_key = std::move(other.get_key);
+    hasher = std::move(other.hasher);
+    equal = std::move(other.equal);
+    return *this;
   }
 
-public:
+  ~hash_index() {
+    deallocate_table();
+  }
 
-  hash_index() {
-    buckets.reserve(256);
-    for (std::size_t i = 0; i < 256; ++i) {
-      buckets.push_back(bucket {});
+  void swap(hash_index& other) noexcept {
+    using std::swap;
+    swap(get_key, other.get_key);
+    swap(hasher, other.hasher);
+    swap(equal, other.equal);
+    if constexpr (slot_traits::propagate_on_container_swap::value) {
+      swap(alloc, other.alloc);
+    } else {
+      ZEN_ASSERT(alloc == other.alloc);
     }
+    swap(ctrl, other.ctrl);
+    swap(slots, other.slots);
+    swap(num_slots, other.num_slots);
+    swap(num_elements, other.num_elements);
+    swap(growth_left, other.growth_left);
   }
 
-  using value_type = T;
-  using reference = T&;
+  allocator_type get_allocator() const noexcept {
+    return alloc;
+  }
 
-  using iterator = hash_index_iterator< T, KeyT, reference, bucket >;
-  using const_iterator = const_hash_index_iterator< T, KeyT, reference, bucket >;
-
-  void insert(T element) {
-    const auto& key = get_key(element);
-    const auto h = hasher(key);
-    auto& bucket = buckets[h % buckets.size()];
-    bucket.push_back(element);
-  }
-
-  iterator lookup(const KeyT& key) {
-    const auto h = hasher(key);
-    const auto bucket_index = h % buckets.size();
-    auto& bucket = buckets[bucket_index];
-    std::size_t i = 0;
-    const auto end = bucket.end();
-    for (auto it = bucket.begin(); it != end; ++it, ++i) {
-      if (get_key(*it) == key) {
-        return hash_index_iterator(bucket, bucket_index, i);
-      }
+  /// Replace the key extractor, for instance because the storage it refers
+  /// to has moved. The new extractor must return the same keys as the old
+  /// one.
+  void set_get_key(GetKeyT new_get_key) noexcept {
+    get_key = std::move(new_get_key);
+  }
+
+  size_type size() const noexcept {
+    return num_elements;
+  }
+
+  bool empty() const noexcept {
+    return num_elements == 0;
+  }
+
+  /// The amount of slots, including those that are not in use.
+  size_type capacity() const noexcept {
+    return num_slots;
+  }
+
+  float load_factor() const noexcept {
+    return num_slots == 0 ? 0 : static_cast<float>(num_elements) / num_slots;
+  }
+
+  /// Make room for at least @p count elements without rehashing.
+  void reserve(size_type count) {
+    auto capacity = num_slots == 0 ? group_width : num_slots;
+    while (max_load(capacity) < count) {
+      capacity *= 2;
+    }
+    if (capacity != num_slots) {
+      rehash(capacity);
     }
-    return end();
   }
 
-  const_iterator lookup(const KeyT& key) const {
-    const auto h = hasher(key);
-    const auto bucket_index = h % buckets.size();
-    auto& bucket = buckets[bucket_index];
-    std::size_t i = 0;
-    const auto end = bucket.end();
-    for (auto it = bucket.begin(); it != end; ++it, ++i) {
-      if (get_key(*it) == key) {
-        return const_hash_index_iterator(bucket, bucket_index, i);
+  /// Remove every element while keeping the allocated slots.
+  void clear() noexcept {
+    for (std::size_t i = 0; i < num_slots; ++i) {
+      if (ctrl[i] >= 0) {
+        slot_traits::destroy(alloc, slots + i);
       }
     }
-    return cend();
+    if (num_slots > 0) {
+      std::memset(ctrl, static_cast<unsigned char>(hash_index_empty), num_slots + group_width);
+    }
+    num_elements = 0;
+    growth_left = max_load(num_slots);
+  }
+
+  /// Add @p element unless an element with the same key is already present.
+  ///
+  /// @return An iterator to the element with the key of @p element and
+  /// whether @p element was added.
+  std::pair<iterator, bool> insert(T element) {
+    return insert_with(get_key(element), [&] { return std::move(element); });
+  }
+
+  /// Add the element returned by @p make unless an element with @p key is
+  /// already present.
+  ///
+  /// The key is only hashed once and @p make is only called when the element
+  /// is actually added. The element must have a key that is equal to @p key.
+  template<typename K, typename MakeT>
+  std::pair<iterator, bool> insert_with(const K& key, MakeT&& make) {
+    const auto h = hash_key(key);
+    auto i = find_slot(key, h);
+    if (i != num_slots) {
+      return { make_iterator(i), false };
+    }
+    i = prepare_insert(h);
+    slot_traits::construct(alloc, slots + i, make());
+    set_ctrl(i, get_h2(h));
+    ++num_elements;
+    return { make_iterator(i), true };
+  }
+
+  template<typename K>
+  iterator lookup(const K& key) {
+    return make_iterator(find_slot(key, hash_key(key)));
+  }
+
+  template<typename K>
+  const_iterator lookup(const K& key) const {
+    return make_iterator(find_slot(key, hash_key(key)));
+  }
+
+  template<typename K>
+  bool contains(const K& key) const {
+    return find_slot(key, hash_key(key)) != num_slots;
+  }
+
+  /// Remove the element with the given key, if any.
+  ///
+  /// @return The amount of elements that were removed.
+  template<typename K>
+  requires (!std::is_convertible_v<const K&, const_iterator>)
+  size_type erase(const K& key) {
+    auto i = find_slot(key, hash_key(key));
+    if (i == num_slots) {
+      return 0;
+    }
+    erase_slot(i);
+    return 1;
+  }
+
+  void erase(const_iterator pos) noexcept {
+    erase_slot(pos.slot - slots);
   }
 
   iterator begin() noexcept {
-    return iterator(buckets, 0, 0);
+    auto it = make_iterator(0);
+    it.skip_free();
+    return it;
   }
 
   iterator end() noexcept {
-    return iterator(buckets, buckets.size(), 0);
+    return make_iterator(num_slots);
   }
 
   const_iterator begin() const noexcept {
@@ -170,11 +657,13 @@ public:
   }
 
   const_iterator cbegin() const noexcept {
-    return const_iterator(buckets, 0, 0);
+    auto it = make_iterator(0);
+    it.skip_free();
+    return it;
   }
 
   const_iterator cend() const noexcept {
-    return const_iterator(buckets, buckets.size(), 0);
+    return make_iterator(num_slots);
   }
 
 };
@@ -1,11 +1,17 @@
 #ifndef ZEN_JSON_HPP
 #define ZEN_JSON_HPP
 
+#include <cstdint>
 #include <memory>
 #include <istream>
+#include <optional>
 #include <ostream>
+#include <string_view>
+#include <vector>
 
+#include "zen/bytestring.hpp"
 #include "zen/config.hpp"
+#include "zen/output_sink.hpp"
 #include "zen/transformer.hpp"
 #include "zen/value.hpp"
 #include "zen/either.hpp"
@@ -31,12 +37,211 @@ enum class json_token_type {
 enum class json_parse_error {
   unrecognised_escape_sequence,
   unexpected_character,
+  unexpected_end_of_input,
+  input_too_large,
+  no_such_field,
+  index_out_of_range,
+  incorrect_type,
+  number_out_of_range,
 };
 
 using json_parse_result = either<json_parse_error, value>;
 
 json_parse_result parse_json(std::istream& in);
+
+/// Parse a JSON text that is fully available in memory.
+///
+/// Unlike the overload that accepts a `std::istream`, these overloads scan the
+/// input directly using pointer arithmetic, without going through a stream
+/// buffer.
+json_parse_result parse_json(const char* data, std::size_t size);
+json_parse_result parse_json(std::string_view in);
 json_parse_result parse_json(const std::string& in);
+json_parse_result parse_json(const bytestring& in);
+json_parse_result parse_json(const char* in);
+
+using json_pool_parse_result = either<json_parse_error, pool_value>;
+
+/// Parse a JSON text that is fully available in memory, allocating every
+/// array, object and string inside @p pool.
+///
+/// Dropping the resulting value does not release any memory. Instead,
+/// everything is freed at once when the pool is destroyed, so @p pool must
+/// outlive the result.
+///
+/// ```
+/// zen::growing_bump_ptr_pool pool;
+/// auto result = zen::parse_json(text, pool);
+/// ```
+json_pool_parse_result parse_json(const char* data, std::size_t size, allocator_ref pool);
+json_pool_parse_result parse_json(std::string_view in, allocator_ref pool);
+
+/// Receives the values of a JSON text as they are encountered, without
+/// building a @ref value.
+///
+/// Every callback does nothing by default, so that a handler only needs to
+/// override the events it is interested in. Strings and keys are passed as
+/// views that are only valid for the duration of the call. When they do not
+/// contain escape sequences, they point directly into the input.
+///
+/// ```
+/// struct count_ids : zen::json_handler {
+///   std::size_t count = 0;
+///   void on_key(std::string_view key) override {
+///     if (key == "id") {
+///       ++count;
+///     }
+///   }
+/// };
+/// ```
+///
+/// @see parse_json
+class json_handler {
+public:
+
+  virtual void on_object_start() {}
+  virtual void on_object_end() {}
+  virtual void on_array_start() {}
+  virtual void on_array_end() {}
+  virtual void on_key(std::string_view) {}
+  virtual void on_string(std::string_view) {}
+  virtual void on_integer(bigint) {}
+  virtual void on_fractional(fractional) {}
+  virtual void on_boolean(bool) {}
+  virtual void on_null() {}
+
+  virtual ~json_handler() = default;
+
+};
+
+/// Parse a JSON text that is fully available in memory, reporting its
+/// contents to @p handler.
+///
+/// Events are reported while parsing, so the handler may already have
+/// received some of them when an error is returned.
+either<json_parse_error, void> parse_json(const char* data, std::size_t size, json_handler& handler);
+either<json_parse_error, void> parse_json(std::string_view in, json_handler& handler);
+
+/// An incremental parser for a JSON text that arrives in chunks, such as
+/// over a socket or a pipe.
+///
+/// The values that are still being built are kept between calls to
+/// @ref feed, together with any string, number or literal that was cut off at
+/// the end of a chunk. The input itself is never buffered as a whole.
+///
+/// ```
+/// zen::json_push_parser parser;
+/// while (auto n = read(fd, buffer, sizeof(buffer))) {
+///   ZEN_TRY_DISCARD(parser.feed(buffer, n));
+/// }
+/// auto result = parser.finish();
+/// ```
+class json_push_parser {
+
+  enum class state {
+    value,
+    value_or_array_end,
+    key,
+    key_or_object_end,
+    colon,
+    comma_or_end,
+    string,
+    scalar,
+    done,
+  };
+
+  state curr = state::value;
+
+  /// Whether the string that is being scanned is the key of a field.
+  bool token_is_key = false;
+
+  std::vector<value> building;
+  std::vector<string> keys;
+  std::optional<value> result;
+
+  /// The part of a token that was found at the end of a previous chunk.
+  string pending;
+
+  /// Whether the last character of @ref pending is an unescaped backslash
+  /// inside of a string.
+  bool pending_escaped = false;
+
+  std::optional<json_parse_error> error;
+
+  either<json_parse_error, void> feed_impl(const char* ptr, const char* end);
+  either<json_parse_error, void> add_string(const char* ptr, const char* end);
+  either<json_parse_error, void> add_scalar(const char* ptr, const char* end);
+  void add(value&& element);
+  void end_container();
+
+public:
+
+  /// Parse the next chunk of input.
+  ///
+  /// Once an error has been returned, all subsequent calls return the same
+  /// error.
+  either<json_parse_error, void> feed(const char* data, std::size_t size);
+
+  /// Signal that no more input will follow and get the parsed value.
+  ///
+  /// The parser is reset afterwards, so that it can be used for a new text.
+  json_parse_result finish();
+
+};
+
+/// The byte offsets of the structural characters in a JSON text.
+///
+/// An offset is recorded for every `{`, `}`, `[`, `]`, `:` and `,` that is
+/// not part of a string, for the opening quote of every string and for the
+/// first character of every other scalar, in the order in which they appear.
+///
+/// @see index_json
+using json_structural_index = std::vector<std::uint32_t>;
+
+/// The implementation used to locate structural characters.
+///
+/// Kernels that are not supported by the compiler or by the CPU silently fall
+/// back to the scalar kernel.
+enum class json_index_kernel {
+  automatic,
+  scalar,
+  sse42,
+  avx2,
+};
+
+/// Build the structural index of the given JSON text.
+///
+/// The input is processed in blocks of 64 bytes which are classified using
+/// bitmasks, so that the cost of finding structural characters does not depend
+/// on the amount of branches in the text.
+///
+/// Returns `false` if the text ends inside a string. The offsets found up until
+/// then are still written to @p out.
+///
+/// @see parse_json_indexed
+bool index_json(
+  const char* data,
+  std::size_t size,
+  json_structural_index& out,
+  json_index_kernel kernel = json_index_kernel::automatic
+);
+
+/// Parse a JSON text that is fully available in memory using a two-stage
+/// parser.
+///
+/// The first stage builds a structural index with @ref index_json, after which
+/// the second stage builds the @ref value by walking over that index. The
+/// result is the same as that of @ref parse_json.
+///
+/// Inputs of 4 GiB or more are rejected with json_parse_error::input_too_large.
+json_parse_result parse_json_indexed(const char* data, std::size_t size);
+json_parse_result parse_json_indexed(const std::string& in);
+
+/// Write an indented representation of @p v as JSON.
+void print(const value& v, std::ostream& out);
+
+/// Get an indented representation of @p v as JSON.
+std::string to_string(const value& v);
 
 struct json_encode_opts {
   std::string indentation = "";
@@ -56,6 +261,16 @@ std::unique_ptr<transformer> make_json_encoder(
   json_encode_opts opts = {}
 );
 
+/// Create an encoder that writes to the given sink.
+///
+/// The sink is flushed whenever a top-level value has been written
+/// completely, but not in between, so that large documents are handed to the
+/// destination in big blocks.
+std::unique_ptr<transformer> make_json_encoder(
+  output_sink& output,
+  json_encode_opts opts = {}
+);
+
 template<typename InputT, typename T>
 void decode_json(InputT input, T& value) {
   auto decoder = make_json_decoder(input);
@@ -0,0 +1,369 @@
+/// @file
+/// @brief A compact, read-only representation of a parsed JSON text.
+///
+/// A @ref json_document stores an entire JSON text in one flat array of 64-bit
+/// words, called the tape, together with one buffer that holds the contents
+/// of all strings. Parsing a document therefore costs two allocations in
+/// total, no matter how many values it contains.
+///
+/// Every word on the tape starts with a tag in its most significant byte,
+/// followed by a payload of 56 bits:
+///
+/// | Tag | Value      | Payload                                                          |
+/// |-----|------------|------------------------------------------------------------------|
+/// | `{` | object     | index after the matching `}` and the number of fields            |
+/// | `}` | end object | index of the matching `{`                                        |
+/// | `[` | array      | index after the matching `]` and the number of elements          |
+/// | `]` | end array  | index of the matching `[`                                        |
+/// | `"` | string     | offset into the string buffer; the next word holds the length    |
+/// | `l` | integer    | none; the next word holds the integer                            |
+/// | `d` | fractional | none; the next word holds the bits of the double                 |
+/// | `t` | true       | none                                                             |
+/// | `f` | false      | none                                                             |
+/// | `n` | null       | none                                                             |
+///
+/// The fields of an object are stored as a string holding the key followed by
+/// the value. Documents are navigated using @ref json_view, which is nothing
+/// more than a pointer to the document and an index into the tape.
+
+#ifndef ZEN_JSON_DOCUMENT_HPP
+#define ZEN_JSON_DOCUMENT_HPP
+
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "zen/config.hpp"
+#include "zen/either.hpp"
+#include "zen/iterator_range.hpp"
+#include "zen/json.hpp"
+#include "zen/value.hpp"
+
+ZEN_NAMESPACE_START
+
+class json_document;
+class json_array_iterator;
+class json_object_iterator;
+
+/// @private
+#define ZEN_JSON_TAPE_PAYLOAD_MASK 0x00FFFFFFFFFFFFFFULL
+
+/// @private
+#define ZEN_JSON_TAPE_COUNT_MASK 0xFFFFFF
+
+/// A cheap, non-owning cursor pointing to a value inside a @ref json_document.
+///
+/// Views are only valid for as long as the document they point into.
+class json_view {
+
+  friend class json_document;
+  friend class json_array_iterator;
+  friend class json_object_iterator;
+
+  const std::uint64_t* tape;
+  const char* strings;
+  std::size_t index;
+
+  json_view(const std::uint64_t* tape, const char* strings, std::size_t index):
+    tape(tape), strings(strings), index(index) {}
+
+  char tag() const {
+    return static_cast<char>(tape[index] >> 56);
+  }
+
+  std::uint64_t payload() const {
+    return tape[index] & ZEN_JSON_TAPE_PAYLOAD_MASK;
+  }
+
+  /// Get the index right after this value, skipping over any nested values.
+  std::size_t next_index() const {
+    switch (tag()) {
+      case '{':
+      case '[':
+        return payload() & 0xFFFFFFFF;
+      case '"':
+      case 'l':
+      case 'd':
+        return index + 2;
+      default:
+        return index + 1;
+    }
+  }
+
+public:
+
+  value_type get_type() const {
+    switch (tag()) {
+      case '{':
+        return value_type::object;
+      case '[':
+        return value_type::array;
+      case '"':
+        return value_type::string;
+      case 'l':
+        return value_type::integer;
+      case 'd':
+        return value_type::fractional;
+      case 't':
+      case 'f':
+        return value_type::boolean;
+      case 'n':
+        return value_type::null;
+      default:
+        ZEN_UNREACHABLE
+    }
+  }
+
+  bool is_object() const {
+    return tag() == '{';
+  }
+
+  bool is_array() const {
+    return tag() == '[';
+  }
+
+  bool is_string() const {
+    return tag() == '"';
+  }
+
+  bool is_integer() const {
+    return tag() == 'l';
+  }
+
+  bool is_fractional() const {
+    return tag() == 'd';
+  }
+
+  bool is_boolean() const {
+    return tag() == 't' || tag() == 'f';
+  }
+
+  bool is_true() const {
+    return tag() == 't';
+  }
+
+  bool is_false() const {
+    return tag() == 'f';
+  }
+
+  bool is_null() const {
+    return tag() == 'n';
+  }
+
+  bool as_boolean() const {
+    ZEN_ASSERT(is_boolean());
+    return tag() == 't';
+  }
+
+  bigint as_integer() const {
+    ZEN_ASSERT(is_integer());
+    return static_cast<bigint>(tape[index + 1]);
+  }
+
+  fractional as_fractional() const {
+    ZEN_ASSERT(is_fractional());
+    return std::bit_cast<fractional>(tape[index + 1]);
+  }
+
+  std::string_view as_string() const {
+    ZEN_ASSERT(is_string());
+    return std::string_view { strings + payload(), static_cast<std::size_t>(tape[index + 1]) };
+  }
+
+  /// Get the amount of elements in an array or the amount of fields in an
+  /// object.
+  ///
+  /// This operation is O(1) for containers with fewer than 2^24 children.
+  std::size_t size() const {
+    ZEN_ASSERT(is_array() || is_object());
+    std::size_t count = (payload() >> 32) & ZEN_JSON_TAPE_COUNT_MASK;
+    if (ZEN_LIKELY(count < ZEN_JSON_TAPE_COUNT_MASK)) {
+      return count;
+    }
+    count = 0;
+    auto last = next_index() - 1;
+    for (auto i = index + 1; i != last; i = json_view(tape, strings, i).next_index()) {
+      ++count;
+    }
+    return is_object() ? count / 2 : count;
+  }
+
+  bool empty() const {
+    return next_index() == index + 2;
+  }
+
+  /// Get a range over the elements of an array.
+  iterator_range<json_array_iterator> elements() const;
+
+  /// Get a range over the fields of an object.
+  iterator_range<json_object_iterator> fields() const;
+
+  /// Get the element at the given position in an array.
+  ///
+  /// This operation is O(n) in the amount of preceding elements.
+  json_view operator[](std::size_t position) const;
+
+  /// Look up the value of a field in an object.
+  ///
+  /// This operation is O(n) in the amount of fields.
+  std::optional<json_view> find(std::string_view key) const;
+
+  json_view operator[](std::string_view key) const;
+
+  /// Copy this value and everything nested in it into a @ref value.
+  value to_value() const;
+
+};
+
+class json_array_iterator {
+
+  friend class json_view;
+
+  json_view curr;
+
+  json_array_iterator(json_view curr):
+    curr(curr) {}
+
+public:
+
+  using value_type = json_view;
+  using reference = json_view;
+  using pointer = void;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+  json_view operator*() const {
+    return curr;
+  }
+
+  json_array_iterator& operator++() {
+    curr.index = curr.next_index();
+    return *this;
+  }
+
+  json_array_iterator operator++(int) {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+
+  bool operator==(const json_array_iterator& other) const {
+    return curr.index == other.curr.index;
+  }
+
+};
+
+class json_object_iterator {
+
+  friend class json_view;
+
+  json_view curr;
+
+  json_object_iterator(json_view curr):
+    curr(curr) {}
+
+public:
+
+  using value_type = std::pair<std::string_view, json_view>;
+  using reference = value_type;
+  using pointer = void;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+  value_type operator*() const {
+    return { curr.as_string(), json_view(curr.tape, curr.strings, curr.index + 2) };
+  }
+
+  json_object_iterator& operator++() {
+    curr.index = json_view(curr.tape, curr.strings, curr.index + 2).next_index();
+    return *this;
+  }
+
+  json_object_iterator operator++(int) {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+
+  bool operator==(const json_object_iterator& other) const {
+    return curr.index == other.curr.index;
+  }
+
+};
+
+inline iterator_range<json_array_iterator> json_view::elements() const {
+  ZEN_ASSERT(is_array());
+  return {
+    json_array_iterator(json_view(tape, strings, index + 1)),
+    json_array_iterator(json_view(tape, strings, next_index() - 1)),
+  };
+}
+
+inline iterator_range<json_object_iterator> json_view::fields() const {
+  ZEN_ASSERT(is_object());
+  return {
+    json_object_iterator(json_view(tape, strings, index + 1)),
+    json_object_iterator(json_view(tape, strings, next_index() - 1)),
+  };
+}
+
+inline json_view json_view::operator[](std::size_t position) const {
+  auto it = elements().begin();
+  for (std::size_t i = 0; i < position; ++i) {
+    ++it;
+  }
+  return *it;
+}
+
+inline std::optional<json_view> json_view::find(std::string_view key) const {
+  for (auto [name, field]: fields()) {
+    if (name == key) {
+      return field;
+    }
+  }
+  return {};
+}
+
+inline json_view json_view::operator[](std::string_view key) const {
+  auto field = find(key);
+  ZEN_ASSERT(field.has_value());
+  return *field;
+}
+
+/// A parsed JSON text, stored as a flat tape of 64-bit words.
+///
+/// @see parse_json_document
+class json_document {
+
+  std::unique_ptr<std::uint64_t[]> tape;
+  std::unique_ptr<char[]> strings;
+
+public:
+
+  /// @private
+  json_document(std::unique_ptr<std::uint64_t[]> tape, std::unique_ptr<char[]> strings):
+    tape(std::move(tape)), strings(std::move(strings)) {}
+
+  json_view root() const {
+    return json_view(tape.get(), strings.get(), 0);
+  }
+
+};
+
+using json_document_result = either<json_parse_error, json_document>;
+
+/// Parse a JSON text that is fully available in memory into a
+/// @ref json_document.
+///
+/// The tape and the string buffer are sized upfront based on the size of the
+/// input, so parsing performs exactly two allocations.
+json_document_result parse_json_document(const char* data, std::size_t size);
+json_document_result parse_json_document(std::string_view in);
+
+ZEN_NAMESPACE_END
+
+#endif // of #ifndef ZEN_JSON_DOCUMENT_HPP
@@ -0,0 +1,132 @@
+/// @file
+/// @brief Lazy, on-demand navigation of a JSON text.
+///
+/// Many programs only need a handful of fields out of a large JSON text.
+/// Instead of building a full @ref value, @ref parse_json_ondemand returns a
+/// cursor into the text that is only moved forward when a field or element is
+/// requested. Subtrees that are passed over on the way are skipped by counting
+/// brackets, so they are neither validated nor materialized.
+///
+/// ```
+/// auto doc = zen::parse_json_ondemand(message);
+/// auto id = doc["user"]["id"].get<zen::bigint>();
+/// if (id.is_left()) {
+///   // the field was missing, had the wrong type or was malformed
+/// }
+/// ```
+///
+/// Errors are carried along by the cursor and only reported when a value is
+/// requested, so that lookups can be chained without checking every step.
+
+#ifndef ZEN_JSON_ONDEMAND_HPP
+#define ZEN_JSON_ONDEMAND_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+#include "zen/config.hpp"
+#include "zen/either.hpp"
+#include "zen/json.hpp"
+#include "zen/value.hpp"
+
+ZEN_NAMESPACE_START
+
+class json_ondemand_value;
+
+json_ondemand_value parse_json_ondemand(const char* data, std::size_t size);
+
+/// A cursor pointing to the start of a value inside a JSON text.
+///
+/// The cursor does not own the text it points into; the text must outlive
+/// it.
+class json_ondemand_value {
+
+  friend json_ondemand_value parse_json_ondemand(const char* data, std::size_t size);
+
+  const char* ptr;
+  const char* end;
+  json_parse_error error;
+
+  json_ondemand_value(const char* ptr, const char* end):
+    ptr(ptr), end(end), error() {}
+
+  json_ondemand_value(json_parse_error error):
+    ptr(nullptr), end(nullptr), error(error) {}
+
+  /// Get the position right after this value, skipping over any nested
+  /// values.
+  either<json_parse_error, const char*> skip() const;
+
+public:
+
+  /// Check whether an error occurred while navigating to this value.
+  bool has_error() const {
+    return ptr == nullptr;
+  }
+
+  json_parse_error get_error() const {
+    ZEN_ASSERT(has_error());
+    return error;
+  }
+
+  either<json_parse_error, value_type> get_type() const;
+
+  /// Look up the value of a field in an object.
+  ///
+  /// Fields that come before the requested field are skipped without being
+  /// validated. This operation is O(n) in the size of the object.
+  json_ondemand_value operator[](std::string_view key) const;
+
+  /// Get the element at the given position in an array.
+  ///
+  /// Elements that come before the requested element are skipped without
+  /// being validated. This operation is O(n) in the size of the array.
+  json_ondemand_value operator[](std::size_t position) const;
+
+  /// Get the text of this value exactly as it appears in the input.
+  either<json_parse_error, std::string_view> get_raw_json() const;
+
+  either<json_parse_error, bool> get_boolean() const;
+
+  either<json_parse_error, bigint> get_integer() const;
+
+  /// Get the value of a number, converting integers if needed.
+  either<json_parse_error, fractional> get_fractional() const;
+
+  /// Decode a string, resolving any escape sequences.
+  either<json_parse_error, string> get_string() const;
+
+  /// Fully parse this value and everything nested in it into a @ref value.
+  either<json_parse_error, value> get_value() const;
+
+  template<typename T>
+  either<json_parse_error, T> get() const {
+    if constexpr (std::is_same_v<T, bool>) {
+      return get_boolean();
+    } else if constexpr (std::is_same_v<T, bigint>) {
+      return get_integer();
+    } else if constexpr (std::is_same_v<T, fractional>) {
+      return get_fractional();
+    } else if constexpr (std::is_same_v<T, string>) {
+      return get_string();
+    } else if constexpr (std::is_same_v<T, value>) {
+      return get_value();
+    } else {
+      static_assert(!std::is_same_v<T, T>, "type cannot be read from a JSON value");
+    }
+  }
+
+};
+
+/// Lazily parse a JSON text that is fully available in memory.
+///
+/// No work is done upfront besides skipping leading whitespace. Any errors,
+/// including an empty input, are reported when a value is requested from the
+/// cursor. Content after the root value is not checked.
+json_ondemand_value parse_json_ondemand(const char* data, std::size_t size);
+json_ondemand_value parse_json_ondemand(std::string_view in);
+
+ZEN_NAMESPACE_END
+
+#endif // of #ifndef ZEN_JSON_ONDEMAND_HPP
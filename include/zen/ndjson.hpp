@@ -0,0 +1,81 @@
+/// @file
+/// @brief Parallel parsing of newline-delimited JSON.
+///
+/// Newline-delimited JSON, also known as JSON Lines, stores one JSON text per
+/// line. Because every line can be parsed independently, the input is split
+/// into chunks at newline boundaries and the chunks are handed out to a pool
+/// of worker threads.
+///
+/// ```
+/// zen::parse_ndjson(logs, [](std::size_t offset, zen::json_parse_result result) {
+///   if (result.is_left()) {
+///     std::cerr << "invalid JSON at byte " << offset << "\n";
+///   }
+/// });
+/// ```
+
+#ifndef ZEN_NDJSON_HPP
+#define ZEN_NDJSON_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "zen/config.hpp"
+#include "zen/either.hpp"
+#include "zen/fs/path.hpp"
+#include "zen/json.hpp"
+
+ZEN_NAMESPACE_START
+
+/// Called for every document that was parsed, together with the byte offset
+/// of the line it was found on.
+using ndjson_callback = std::function<void(std::size_t offset, json_parse_result result)>;
+
+struct ndjson_opts {
+
+  /// The amount of worker threads to use. Zero means one thread for every
+  /// hardware thread. With one thread, everything is parsed on the calling
+  /// thread.
+  std::size_t threads = 0;
+
+  /// The amount of bytes that is handed out to a worker thread at once. A
+  /// chunk is extended up to the next newline so that no line is split.
+  std::size_t chunk_size = 1024 * 1024;
+
+  /// Whether documents are handed back in the order they appear in the input.
+  ///
+  /// When set, the callback is always invoked on the calling thread. When
+  /// unset, the callback is invoked on the worker threads as soon as a
+  /// document is parsed, so it must be safe to call concurrently.
+  bool ordered = true;
+
+};
+
+/// Parse every non-blank line of @p in as a separate JSON text.
+///
+/// Parsing continues after a line fails to parse; the error is handed to the
+/// callback like any other result.
+///
+/// If the callback throws, no more lines are handed to it. All worker
+/// threads are stopped and joined, and then the first exception is rethrown
+/// on the calling thread.
+void parse_ndjson(std::string_view in, const ndjson_callback& callback, ndjson_opts opts = {});
+
+/// Parse every non-blank line of @p in and collect the results in input
+/// order.
+std::vector<json_parse_result> parse_ndjson(std::string_view in, ndjson_opts opts = {});
+
+/// Map a file into memory and parse every non-blank line of it as a separate
+/// JSON text.
+either<std::error_code, void> parse_ndjson_file(
+  const fs::path& filename,
+  const ndjson_callback& callback,
+  ndjson_opts opts = {}
+);
+
+ZEN_NAMESPACE_END
+
+#endif // of #ifndef ZEN_NDJSON_HPP
@@ -0,0 +1,213 @@
+/// @file
+/// @brief Buffered output to streams, file descriptors and strings.
+///
+/// An @ref output_sink collects small writes in an internal buffer and only
+/// hands them to their destination in large blocks. This avoids the overhead
+/// of formatting and locking that `std::ostream::operator<<` incurs on every
+/// call.
+///
+/// ```
+/// zen::fd_sink out { STDOUT_FILENO };
+/// out.write("Hello, ");
+/// out.write_integer(42);
+/// out.put('\n');
+/// out.flush();
+/// ```
+
+#ifndef ZEN_OUTPUT_SINK_HPP
+#define ZEN_OUTPUT_SINK_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "zen/config.hpp"
+
+ZEN_NAMESPACE_START
+
+#define ZEN_DEFAULT_OUTPUT_SINK_CAPACITY (64 * 1024)
+
+/// A buffer that collects output and passes it on to a destination when it
+/// is full or when it is explicitly flushed.
+class output_sink {
+
+  std::unique_ptr<char[]> buffer;
+  std::size_t capacity;
+  std::size_t size = 0;
+
+  void grow(std::size_t min_capacity);
+
+protected:
+
+  /// Pass the given bytes on to the destination.
+  virtual void write_through(const char* data, std::size_t size) = 0;
+
+public:
+
+  /// Create a sink that buffers up to @p capacity bytes before writing them
+  /// through. A capacity of zero is treated as a capacity of one byte.
+  output_sink(std::size_t capacity = ZEN_DEFAULT_OUTPUT_SINK_CAPACITY):
+    buffer(new char[std::max<std::size_t>(capacity, 1)]), capacity(std::max<std::size_t>(capacity, 1)) {}
+
+  output_sink(const output_sink&) = delete;
+  output_sink& operator=(const output_sink&) = delete;
+
+  /// Get a pointer to at least @p count bytes at the end of the buffer.
+  ///
+  /// The bytes only become part of the output after a call to @ref commit.
+  /// Any previously reserved bytes that were not committed are discarded.
+  char* reserve(std::size_t count) {
+    if (ZEN_UNLIKELY(capacity - size < count)) {
+      flush_buffer();
+      if (capacity < count) {
+        grow(count);
+      }
+    }
+    return buffer.get() + size;
+  }
+
+  /// Add @p count bytes that were written through a pointer obtained from
+  /// @ref reserve to the output.
+  void commit(std::size_t count) {
+    ZEN_ASSERT(size + count <= capacity);
+    size += count;
+  }
+
+  void put(char ch) {
+    if (ZEN_UNLIKELY(size == capacity)) {
+      flush_buffer();
+    }
+    buffer[size++] = ch;
+  }
+
+  void write(const char* data, std::size_t count) {
+    if (ZEN_LIKELY(capacity - size >= count)) {
+      std::memcpy(buffer.get() + size, data, count);
+      size += count;
+      return;
+    }
+    flush_buffer();
+    if (count >= capacity) {
+      write_through(data, count);
+      return;
+    }
+    std::memcpy(buffer.get(), data, count);
+    size = count;
+  }
+
+  void write(std::string_view str) {
+    write(str.data(), str.size());
+  }
+
+  /// Write an integer in decimal notation.
+  template<typename T>
+  void write_integer(T value) {
+    auto ptr = reserve(24);
+    auto [end, _] = std::to_chars(ptr, ptr + 24, value);
+    commit(end - ptr);
+  }
+
+  /// Pass everything that is in the buffer on to the destination without
+  /// flushing the destination itself.
+  void flush_buffer() {
+    if (size > 0) {
+      write_through(buffer.get(), size);
+      size = 0;
+    }
+  }
+
+  /// Pass everything that is in the buffer on to the destination and flush
+  /// the destination, if that is supported.
+  virtual void flush() {
+    flush_buffer();
+  }
+
+  virtual ~output_sink() = default;
+
+};
+
+/// Writes its output to a `std::ostream`.
+class ostream_sink : public output_sink {
+
+  std::ostream& out;
+
+protected:
+
+  void write_through(const char* data, std::size_t size) override {
+    out.write(data, size);
+  }
+
+public:
+
+  ostream_sink(std::ostream& out, std::size_t capacity = ZEN_DEFAULT_OUTPUT_SINK_CAPACITY):
+    output_sink(capacity), out(out) {}
+
+  void flush() override {
+    flush_buffer();
+    out.flush();
+  }
+
+  ~ostream_sink() {
+    flush_buffer();
+  }
+
+};
+
+/// Writes its output to a file descriptor.
+///
+/// Once writing fails, all further output is dropped and the error is made
+/// available through @ref get_error.
+class fd_sink : public output_sink {
+
+  int fd;
+  std::error_code error;
+
+protected:
+
+  void write_through(const char* data, std::size_t size) override;
+
+public:
+
+  fd_sink(int fd, std::size_t capacity = ZEN_DEFAULT_OUTPUT_SINK_CAPACITY):
+    output_sink(capacity), fd(fd) {}
+
+  std::error_code get_error() const {
+    return error;
+  }
+
+  ~fd_sink() {
+    flush_buffer();
+  }
+
+};
+
+/// Appends its output to a string that is owned by the caller.
+class string_sink : public output_sink {
+
+  std::string& out;
+
+protected:
+
+  void write_through(const char* data, std::size_t size) override {
+    out.append(data, size);
+  }
+
+public:
+
+  string_sink(std::string& out, std::size_t capacity = ZEN_DEFAULT_OUTPUT_SINK_CAPACITY):
+    output_sink(capacity), out(out) {}
+
+  ~string_sink() {
+    flush_buffer();
+  }
+
+};
+
+ZEN_NAMESPACE_END
+
+#endif // of #ifndef ZEN_OUTPUT_SINK_HPP
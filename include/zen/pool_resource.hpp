@@ -0,0 +1,77 @@
+/// @file
+/// @brief A `std::pmr::memory_resource` that allocates from a bump pool.
+///
+/// This lets the containers in `std::pmr` as well as @ref pmr_value allocate
+/// their memory from a Zen++ arena without having to change their type.
+///
+/// ```
+/// zen::pool_resource arena;
+/// std::pmr::vector<std::pmr::string> names { &arena };
+/// names.emplace_back("Bob");
+/// ```
+
+#ifndef ZEN_POOL_RESOURCE_HPP
+#define ZEN_POOL_RESOURCE_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+#include "zen/config.hpp"
+#include "zen/bump_ptr_pool.hpp"
+
+ZEN_NAMESPACE_START
+
+/// A memory resource that carves its memory out of a
+/// @ref growing_bump_ptr_pool that it owns.
+///
+/// Deallocating is a no-op. Memory is reclaimed all at once when the resource
+/// is destroyed or when @ref release is called. Containers still run the
+/// destructors of their elements themselves, so no destructor is registered
+/// with the pool.
+class pool_resource : public std::pmr::memory_resource {
+
+  growing_bump_ptr_pool pool;
+
+protected:
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    auto ptr = pool.allocate(bytes, alignment);
+    if (ZEN_UNLIKELY(ptr == nullptr)) {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+
+  void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+public:
+
+  pool_resource(std::size_t min_size = ZEN_DEFAULT_GROWING_BUMP_PTR_POOL_MIN_SIZE):
+    pool(min_size) {}
+
+  pool_resource(const pool_resource&) = delete;
+  pool_resource& operator=(const pool_resource&) = delete;
+
+  /// Get the underlying pool, for instance to @ref growing_bump_ptr_pool::mark
+  /// a position and rewind to it later on.
+  growing_bump_ptr_pool& get_pool() {
+    return pool;
+  }
+
+  /// Make all memory that was handed out available again.
+  ///
+  /// Every container that allocated from this resource must be gone.
+  void release() {
+    pool.reset();
+  }
+
+};
+
+ZEN_NAMESPACE_END
+
+#endif // of #ifndef ZEN_POOL_RESOURCE_HPP
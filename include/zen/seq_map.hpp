@@ -1,63 +1,403 @@
 #ifndef ZEN_SEQMAP_HPP
 #define ZEN_SEQMAP_HPP
 
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <list>
 
 #include "zen/config.hpp"
+#include "zen/hash.hpp"
 #include "zen/hash_index.hpp"
 
 ZEN_NAMESPACE_START
 
-template<typename KeyT, typename ValueT>
+/// Hashes keys of a @ref seq_map in such a way that anything that converts
+/// to a `std::string_view` can be used to look up a string key.
+template<typename KeyT>
+struct seq_map_hash {
+
+  using is_transparent = void;
+
+  template<typename K>
+  std::size_t operator()(const K& key) const {
+    if constexpr (std::is_convertible_v<const K&, std::string_view>) {
+      return string_hash{}(key);
+    } else {
+      return hash<KeyT>{}(key);
+    }
+  }
+
+};
+
+template<typename EntryIterT, typename T>
+class seq_map_iterator {
+
+  template<typename KeyT, typename ValueT, typename Alloc>
+  friend class seq_map;
+
+  template<typename EntryIterT2, typename T2>
+  friend class seq_map_iterator;
+
+  EntryIterT current;
+  EntryIterT end;
+
+  void skip_erased() {
+    while (current != end && !current->has_value()) {
+      ++current;
+    }
+  }
+
+public:
+
+  using value_type = std::remove_const_t<T>;
+  using reference = T&;
+  using pointer = T*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+  seq_map_iterator() = default;
+
+  seq_map_iterator(EntryIterT current, EntryIterT end):
+    current(current), end(end) {
+      skip_erased();
+    }
+
+  /// Allow a mutable iterator to be converted to a const iterator.
+  template<typename EntryIterT2, typename T2>
+  requires (std::is_same_v<const T2, T> && !std::is_same_v<T2, T>)
+  seq_map_iterator(const seq_map_iterator<EntryIterT2, T2>& other):
+    current(other.current), end(other.end) {}
+
+  reference operator*() const {
+    return **current;
+  }
+
+  pointer operator->() const {
+    return &**current;
+  }
+
+  seq_map_iterator& operator++() {
+    ++current;
+    skip_erased();
+    return *this;
+  }
+
+  seq_map_iterator operator++(int) {
+    auto copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  bool operator==(const seq_map_iterator& other) const {
+    return current == other.current;
+  }
+
+};
+
+/// A hash map that remembers the order in which its entries were added.
+///
+/// Entries are stored in one contiguous vector in insertion order and a
+/// @ref hash_index maps keys to positions in that vector. Erasing an entry
+/// leaves a hole behind that is skipped during iteration, so that erasing
+/// never moves other entries. Holes are removed at once when they start to
+/// outnumber the entries that are left.
+///
+/// Entries can be looked up with any key type that @p KeyT can be compared
+/// to. In particular, a map with string keys accepts `std::string_view`.
+template<
+  typename KeyT,
+  typename ValueT,
+  typename Alloc = std::allocator<std::pair<KeyT, ValueT>>
+>
 class seq_map {
 public:
 
+  using key_type = KeyT;
+  using mapped_type = ValueT;
   using value_type = std::pair<KeyT, ValueT>;
   using reference = value_type&;
+  using const_reference = const value_type&;
   using size_type = std::size_t;
+  using allocator_type = Alloc;
 
 private:
 
-  struct entry {
-    value_type value;
+  using entry = std::optional<value_type>;
+
+  template<typename T>
+  using rebind_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+  using entry_list = std::vector<entry, rebind_alloc<entry>>;
+
+  struct get_entry_key {
+
+    const entry_list* entries;
+
+    const KeyT& operator()(std::size_t pos) const noexcept {
+      return (*entries)[pos]->first;
+    }
+
   };
 
-  std::list<value_type> entries;
-  hash_index<typename std::list<value_type>::iterator, KeyT> index;
+  entry_list entries;
+
+  /// The amount of erased entries that are still in @ref entries.
+  std::size_t num_erased = 0;
+
+  hash_index<
+    std::size_t,
+    KeyT,
+    rebind_alloc<std::size_t>,
+    get_entry_key,
+    seq_map_hash<KeyT>,
+    std::equal_to<>
+  > index;
+
+  void fix_index() noexcept {
+    index.set_get_key(get_entry_key { &entries });
+  }
+
+  /// Remove every erased entry from @ref entries and rebuild the index.
+  void compact() {
+    std::size_t k = 0;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].has_value()) {
+        if (i != k) {
+          entries[k] = std::move(entries[i]);
+        }
+        ++k;
+      }
+    }
+    entries.erase(entries.begin() + k, entries.end());
+    num_erased = 0;
+    index.clear();
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      index.insert(i);
+    }
+  }
+
+  void erase_at(std::size_t pos) {
+    entries[pos].reset();
+    ++num_erased;
+    if (pos + 1 == entries.size()) {
+      entries.pop_back();
+      --num_erased;
+    }
+  }
 
 public:
 
-  using iterator = typename std::list<value_type>::iterator;
-  using const_iterator = typename std::list<value_type>::const_iterator;
+  using iterator = seq_map_iterator<typename entry_list::iterator, value_type>;
+  using const_iterator = seq_map_iterator<typename entry_list::const_iterator, const value_type>;
+
+  seq_map():
+    index(rebind_alloc<std::size_t>(), get_entry_key { &entries }) {}
+
+  /// Construct an empty map whose entries and index are allocated using
+  /// @p alloc.
+  explicit seq_map(const Alloc& alloc):
+    entries(alloc), index(alloc, get_entry_key { &entries }) {}
+
+  seq_map(const seq_map& other):
+    entries(other.entries), num_erased(other.num_erased), index(other.index) {
+      fix_index();
+    }
+
+  /// Copy @p other into a map whose entries and index are allocated using
+  /// @p alloc.
+  seq_map(const seq_map& other, const Alloc& alloc):
+    entries(other.entries, alloc), num_erased(other.num_erased), index(other.index, alloc) {
+      fix_index();
+    }
+
+  seq_map(seq_map&& other) noexcept:
+    entries(std::move(other.entries)),
+    num_erased(std::exchange(other.num_erased, 0)),
+    index(std::move(other.index)) {
+      fix_index();
+    }
+
+  /// Copy the entries of @p other into this map.
+  ///
+  /// Like the standard containers, this map only adopts the allocator of
+  /// @p other if it propagates on copy assignment, so that a map that was
+  /// allocated from an arena stays in that arena.
+  seq_map& operator=(const seq_map& other) {
+    if (this == &other) {
+      return *this;
+    }
+    entries = other.entries;
+    num_erased = other.num_erased;
+    index = other.index;
+    fix_index();
+    return *this;
+  }
+
+  /// Move the entries of @p other into this map, leaving @p other empty.
+  ///
+  /// If the allocator does not propagate on move assignment and the two
+  /// allocators are not equal, the entries are moved one by one into memory
+  /// from the allocator of this map.
+  seq_map& operator=(seq_map&& other) noexcept(
+    std::allocator_traits<Alloc>::propagate_on_container_move_assignment::value
+    || std::allocator_traits<Alloc>::is_always_equal::value
+  ) {
+    if (this == &other) {
+      return *this;
+    }
+    entries = std::move(other.entries);
+    num_erased = std::exchange(other.num_erased, 0);
+    index = std::move(other.index);
+    fix_index();
+    other.clear();
+    other.fix_index();
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept {
+    return entries.get_allocator();
+  }
 
-  void emplace(const KeyT& key, const ValueT& value) {
-    auto iter = entries.insert(entries.end(), std::make_pair(key, value));
-    index.insert(iter);
+  /// Add an entry at the end of the map unless an entry with the same key
+  /// already exists, in which case the map is left unchanged.
+  ///
+  /// @return An iterator to the entry with the given key and whether the
+  /// entry was added.
+  template<typename K, typename V>
+  std::pair<iterator, bool> emplace(K&& key, V&& value) {
+    if (ZEN_UNLIKELY(num_erased > entries.size() / 2)) {
+      compact();
+    }
+    auto [it, added] = index.insert_with(key, [&] {
+      entries.emplace_back(std::in_place, std::forward<K>(key), std::forward<V>(value));
+      return entries.size() - 1;
+    });
+    return { iterator(entries.begin() + *it, entries.end()), added };
   }
 
-  size_type size() {
-    return entries.size();
+  /// Make room for @p count entries without reallocating.
+  void reserve(size_type count) {
+    entries.reserve(count);
+    index.reserve(count);
+  }
+
+  size_type size() const noexcept {
+    return entries.size() - num_erased;
   }
 
   bool empty() const noexcept {
-    return entries.empty();
+    return size() == 0;
+  }
+
+  void clear() noexcept {
+    entries.clear();
+    index.clear();
+    num_erased = 0;
+  }
+
+  /// Remove all holes that were left behind by erased entries.
+  void shrink_to_fit() {
+    compact();
+    entries.shrink_to_fit();
+  }
+
+  template<typename K>
+  iterator find(const K& key) {
+    auto it = index.lookup(key);
+    if (it == index.end()) {
+      return end();
+    }
+    return iterator(entries.begin() + *it, entries.end());
+  }
+
+  template<typename K>
+  const_iterator find(const K& key) const {
+    auto it = index.lookup(key);
+    if (it == index.end()) {
+      return cend();
+    }
+    return const_iterator(entries.cbegin() + *it, entries.cend());
+  }
+
+  template<typename K>
+  bool contains(const K& key) const {
+    return index.contains(key);
+  }
+
+  /// Remove the entry with the given key, if any.
+  ///
+  /// Iterators to other entries remain valid.
+  ///
+  /// @return The amount of entries that were removed.
+  template<typename K>
+  requires (!std::is_convertible_v<const K&, const_iterator>)
+  size_type erase(const K& key) {
+    auto it = index.lookup(key);
+    if (it == index.end()) {
+      return 0;
+    }
+    auto pos = *it;
+    index.erase(it);
+    erase_at(pos);
+    return 1;
+  }
+
+  /// Remove the entry at @p pos.
+  ///
+  /// @return An iterator to the entry that followed the removed entry.
+  iterator erase(const_iterator pos) {
+    auto i = static_cast<std::size_t>(pos.current - entries.cbegin());
+    index.erase(index.lookup(entries[i]->first));
+    erase_at(i);
+    return iterator(entries.begin() + std::min(i + 1, entries.size()), entries.end());
+  }
+
+  /// Get the value of the entry with the given key, adding an entry with a
+  /// default-constructed value if there is none.
+  template<typename K>
+  ValueT& operator[](K&& key) {
+    auto it = find(key);
+    if (it != end()) {
+      return it->second;
+    }
+    return emplace(KeyT(std::forward<K>(key)), ValueT()).first->second;
+  }
+
+  /// Get the value of the entry with the given key, which must exist.
+  template<typename K>
+  const ValueT& operator[](const K& key) const {
+    auto it = find(key);
+    ZEN_ASSERT(it != cend());
+    return it->second;
+  }
+
+  iterator begin() {
+    return iterator(entries.begin(), entries.end());
+  }
+
+  iterator end() {
+    return iterator(entries.end(), entries.end());
   }
 
-  ValueT& operator[](const KeyT& key) {
-    return *index.lookup(key);
+  const_iterator begin() const {
+    return cbegin();
   }
 
-  const ValueT& operator[](const KeyT& key) const {
-    return *index.lookup(key);
+  const_iterator end() const {
+    return cend();
   }
 
   const_iterator cbegin() const {
-    return entries.cbegin();
+    return const_iterator(entries.cbegin(), entries.cend());
   }
 
   const_iterator cend() const {
-    return entries.cend();
+    return const_iterator(entries.cend(), entries.cend());
   }
 
 };
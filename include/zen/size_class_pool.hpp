@@ -0,0 +1,481 @@
+/// @file
+/// @brief A pool for objects that are freed one by one.
+///
+/// This header defines @ref size_class_pool, an allocator that rounds every
+/// request up to one of a fixed set of size classes and keeps a free list per
+/// size class. Unlike @ref bump_ptr_pool, objects can be given back
+/// individually with @ref size_class_pool::deallocate, after which their
+/// memory is reused for the next object of the same size class.
+///
+/// ```
+/// zen::size_class_pool pool;
+/// auto node = zen::construct<ast_node>(pool);
+/// // ...
+/// pool.deallocate(node);
+/// ```
+
+#ifndef ZEN_SIZE_CLASS_POOL_HPP
+#define ZEN_SIZE_CLASS_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "zen/config.hpp"
+#include "zen/alloc.hpp"
+
+/// The size and alignment of the blocks of memory that objects are carved
+/// out of. Objects that do not fit in a size class get a slab of their own,
+/// rounded up to a multiple of this size.
+#define ZEN_SIZE_CLASS_POOL_SLAB_SIZE (64 * 1024)
+
+/// The maximum amount of free objects per size class that a thread keeps to
+/// itself before it hands half of them back to the pool.
+#define ZEN_SIZE_CLASS_POOL_CACHE_LIMIT 64
+
+ZEN_NAMESPACE_START
+
+class size_class_pool;
+
+/// Maps the pools that are alive to their unique identifiers, so that a
+/// thread that exits can hand its cached objects back to every pool that
+/// still exists.
+struct size_class_pool_registry {
+
+  std::mutex mutex;
+  std::unordered_map<std::uint64_t, size_class_pool*> pools;
+  std::atomic<std::uint64_t> next_id = 1;
+
+  static size_class_pool_registry& get() {
+    static size_class_pool_registry instance;
+    return instance;
+  }
+
+};
+
+/// The objects that a thread took out of a pool and did not use yet.
+struct size_class_pool_cache;
+
+/// The caches of the current thread, one for every pool it has used.
+struct size_class_pool_thread_caches {
+
+  std::uint64_t last_id = 0;
+  size_class_pool_cache* last_cache = nullptr;
+  std::vector<std::pair<std::uint64_t, size_class_pool_cache*>> caches;
+
+  ~size_class_pool_thread_caches();
+
+};
+
+inline thread_local size_class_pool_thread_caches size_class_pool_current_thread;
+
+/// @brief A thread-safe allocator that can free objects individually.
+///
+/// Requests of up to 8 KiB are rounded up to one of 32 size classes. Memory
+/// for each size class is carved out of 64 KiB slabs, and objects that are
+/// freed go onto an intrusive free list for their size class. Every thread
+/// keeps a small cache of free objects per size class, so that most
+/// allocations and deallocations do not need any locking. Larger objects get
+/// a slab of their own, which is returned to the system when the object is
+/// freed.
+///
+/// Each object is followed by a pointer to its destructor, which also marks
+/// whether the object is alive. Objects that are still alive when the pool is
+/// destroyed are destroyed together with it.
+///
+/// @see construct
+/// @see DynamicAllocator
+class size_class_pool {
+
+  friend struct size_class_pool_thread_caches;
+
+public:
+
+  static constexpr std::size_t num_size_classes = 32;
+
+  /// The maximum alignment of objects that fit in a size class. More
+  /// strictly aligned objects get a slab of their own.
+  static constexpr std::size_t block_alignment = 16;
+
+private:
+
+  static constexpr std::size_t slab_size = ZEN_SIZE_CLASS_POOL_SLAB_SIZE;
+  static constexpr std::uint32_t large_size_class = num_size_classes;
+
+  struct slab {
+    slab* prev;
+    slab* next;
+    std::uint32_t size_class;
+    std::size_t block_size;
+    std::size_t num_carved;
+    std::size_t capacity;
+    std::byte* blocks;
+  };
+
+  static constexpr std::size_t slab_header_size = (sizeof(slab) + block_alignment - 1) & ~(block_alignment - 1);
+
+  struct free_list {
+    void* head = nullptr;
+    std::size_t count = 0;
+  };
+
+  std::uint64_t id;
+
+  /// Protects everything below.
+  std::mutex mutex;
+
+  free_list central[num_size_classes];
+  slab* current_slab[num_size_classes] = {};
+  slab* small_slabs = nullptr;
+  slab* large_slabs = nullptr;
+
+  std::vector<size_class_pool_cache*> caches;
+  std::vector<size_class_pool_cache*> idle_caches;
+
+  static std::size_t get_block_size(std::uint32_t size_class) {
+    if (size_class < 8) {
+      return (size_class + 1) * 16;
+    }
+    auto group = (size_class - 8) / 4;
+    auto step = (size_class - 8) % 4;
+    auto base = std::size_t(1) << (7 + group);
+    return base + (step + 1) * (base >> 2);
+  }
+
+  /// Get the smallest size class whose blocks fit @p size bytes plus the
+  /// destructor that follows them.
+  static std::uint32_t get_size_class(std::size_t size) {
+    auto block_size = (size + sizeof(destroy_fn) + block_alignment - 1) & ~(block_alignment - 1);
+    if (block_size <= 128) {
+      return block_size / 16 - 1;
+    }
+    auto k = 63 - __builtin_clzll(block_size - 1);
+    return 8 + (k - 7) * 4 + ((block_size - 1 - (std::size_t(1) << k)) >> (k - 2));
+  }
+
+  static constexpr std::size_t max_small_size = 8 * 1024 - sizeof(destroy_fn);
+
+  static slab* get_slab(const void* ptr) {
+    return reinterpret_cast<slab*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(slab_size - 1));
+  }
+
+  static void* get_next(void* block) {
+    void* next;
+    std::memcpy(&next, block, sizeof(void*));
+    return next;
+  }
+
+  static void set_next(void* block, void* next) {
+    std::memcpy(block, &next, sizeof(void*));
+  }
+
+  static destroy_fn get_destroy(const slab* s, void* block) {
+    destroy_fn out;
+    std::memcpy(&out, static_cast<std::byte*>(block) + s->block_size - sizeof(destroy_fn), sizeof(destroy_fn));
+    return out;
+  }
+
+  static void set_destroy(const slab* s, void* block, destroy_fn destroy) {
+    std::memcpy(static_cast<std::byte*>(block) + s->block_size - sizeof(destroy_fn), &destroy, sizeof(destroy_fn));
+  }
+
+  static void link(slab*& list, slab* s) {
+    s->prev = nullptr;
+    s->next = list;
+    if (list != nullptr) {
+      list->prev = s;
+    }
+    list = s;
+  }
+
+  static void unlink(slab*& list, slab* s) {
+    if (s->prev != nullptr) {
+      s->prev->next = s->next;
+    } else {
+      list = s->next;
+    }
+    if (s->next != nullptr) {
+      s->next->prev = s->prev;
+    }
+  }
+
+  static slab* allocate_slab(std::size_t size) {
+    auto ptr = std::aligned_alloc(slab_size, size);
+    if (ZEN_UNLIKELY(ptr == nullptr)) {
+      return nullptr;
+    }
+    return ::new (ptr) slab {};
+  }
+
+  /// Move up to @p count blocks from the start of @p from to @p to.
+  static void move_blocks(free_list& from, free_list& to, std::size_t count) {
+    while (count > 0 && from.head != nullptr) {
+      auto block = from.head;
+      from.head = get_next(block);
+      --from.count;
+      set_next(block, to.head);
+      to.head = block;
+      ++to.count;
+      --count;
+    }
+  }
+
+  /// Fill the free list of @p cache for @p size_class with blocks from the
+  /// central free list or from fresh memory.
+  bool refill(size_class_pool_cache& cache, std::uint32_t size_class);
+
+  /// Hand the free objects of @p cache back to the central free lists.
+  void flush(size_class_pool_cache& cache, std::uint32_t size_class, std::size_t count);
+
+  size_class_pool_cache* get_cache_slow();
+
+  size_class_pool_cache* get_cache() {
+    auto& current = size_class_pool_current_thread;
+    if (ZEN_LIKELY(current.last_id == id)) {
+      return current.last_cache;
+    }
+    return get_cache_slow();
+  }
+
+  /// Called when a thread that used this pool exits.
+  void release_cache(size_class_pool_cache* cache);
+
+  void* allocate_small(std::size_t sz, destroy_fn destroy);
+
+  void* allocate_large(std::size_t sz, std::size_t alignment, destroy_fn destroy) {
+    if (ZEN_UNLIKELY(alignment > slab_size / 2)) {
+      return nullptr;
+    }
+    auto offset = (slab_header_size + alignment - 1) & ~(alignment - 1);
+    auto block_size = (sz + sizeof(destroy_fn) + block_alignment - 1) & ~(block_alignment - 1);
+    auto total = (offset + block_size + slab_size - 1) & ~(slab_size - 1);
+    auto s = allocate_slab(total);
+    if (ZEN_UNLIKELY(s == nullptr)) {
+      return nullptr;
+    }
+    s->size_class = large_size_class;
+    s->block_size = block_size;
+    s->num_carved = 1;
+    s->capacity = 1;
+    s->blocks = reinterpret_cast<std::byte*>(s) + offset;
+    set_destroy(s, s->blocks, destroy);
+    {
+      std::lock_guard lock { mutex };
+      link(large_slabs, s);
+    }
+    return s->blocks;
+  }
+
+public:
+
+  size_class_pool() {
+    auto& registry = size_class_pool_registry::get();
+    id = registry.next_id.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard lock { registry.mutex };
+    registry.pools.emplace(id, this);
+  }
+
+  size_class_pool(const size_class_pool&) = delete;
+  size_class_pool& operator=(const size_class_pool&) = delete;
+
+  void* allocate(std::size_t sz, std::size_t alignment, destroy_fn destroy) {
+    if (ZEN_LIKELY(sz <= max_small_size && alignment <= block_alignment)) {
+      return allocate_small(sz, destroy);
+    }
+    return allocate_large(sz, alignment, destroy);
+  }
+
+  /// Allocate memory for an object that does not need to be destroyed.
+  void* allocate(std::size_t sz, std::size_t alignment) {
+    return allocate(sz, alignment, destroy_nothing);
+  }
+
+  /// Destroy the object at @p ptr and make its memory available again.
+  ///
+  /// @p ptr must have been returned by @ref allocate on this pool. It may be
+  /// freed by any thread.
+  void deallocate(void* ptr);
+
+  ~size_class_pool();
+
+};
+
+struct size_class_pool_cache {
+  void* heads[size_class_pool::num_size_classes] = {};
+  std::size_t counts[size_class_pool::num_size_classes] = {};
+};
+
+inline size_class_pool_thread_caches::~size_class_pool_thread_caches() {
+  auto& registry = size_class_pool_registry::get();
+  std::lock_guard lock { registry.mutex };
+  for (auto [id, cache]: caches) {
+    auto it = registry.pools.find(id);
+    if (it != registry.pools.end()) {
+      it->second->release_cache(cache);
+    }
+  }
+}
+
+inline bool size_class_pool::refill(size_class_pool_cache& cache, std::uint32_t size_class) {
+  const auto batch = ZEN_SIZE_CLASS_POOL_CACHE_LIMIT / 2;
+  free_list local { cache.heads[size_class], cache.counts[size_class] };
+  std::lock_guard lock { mutex };
+  move_blocks(central[size_class], local, batch);
+  if (local.count == 0) {
+    auto s = current_slab[size_class];
+    if (s == nullptr || s->num_carved == s->capacity) {
+      s = allocate_slab(slab_size);
+      if (ZEN_UNLIKELY(s == nullptr)) {
+        return false;
+      }
+      s->size_class = size_class;
+      s->block_size = get_block_size(size_class);
+      s->num_carved = 0;
+      s->blocks = reinterpret_cast<std::byte*>(s) + slab_header_size;
+      s->capacity = (slab_size - slab_header_size) / s->block_size;
+      link(small_slabs, s);
+      current_slab[size_class] = s;
+    }
+    auto end = std::min(s->num_carved + batch, s->capacity);
+    // Push in reverse, so that blocks are handed out in address order.
+    for (auto i = end; i-- > s->num_carved;) {
+      auto block = s->blocks + i * s->block_size;
+      set_destroy(s, block, nullptr);
+      set_next(block, local.head);
+      local.head = block;
+      ++local.count;
+    }
+    s->num_carved = end;
+  }
+  cache.heads[size_class] = local.head;
+  cache.counts[size_class] = local.count;
+  return true;
+}
+
+inline void size_class_pool::flush(size_class_pool_cache& cache, std::uint32_t size_class, std::size_t count) {
+  free_list local { cache.heads[size_class], cache.counts[size_class] };
+  {
+    std::lock_guard lock { mutex };
+    move_blocks(local, central[size_class], count);
+  }
+  cache.heads[size_class] = local.head;
+  cache.counts[size_class] = local.count;
+}
+
+inline size_class_pool_cache* size_class_pool::get_cache_slow() {
+  auto& current = size_class_pool_current_thread;
+  size_class_pool_cache* cache = nullptr;
+  for (auto [cache_id, c]: current.caches) {
+    if (cache_id == id) {
+      cache = c;
+      break;
+    }
+  }
+  if (cache == nullptr) {
+    {
+      std::lock_guard lock { mutex };
+      if (idle_caches.empty()) {
+        cache = new size_class_pool_cache;
+        caches.push_back(cache);
+      } else {
+        cache = idle_caches.back();
+        idle_caches.pop_back();
+      }
+    }
+    if (current.caches.size() >= 8) {
+      // Forget about the caches of pools that no longer exist.
+      auto& registry = size_class_pool_registry::get();
+      std::lock_guard lock { registry.mutex };
+      std::erase_if(current.caches, [&](const auto& entry) {
+        return !registry.pools.contains(entry.first);
+      });
+    }
+    current.caches.emplace_back(id, cache);
+  }
+  current.last_id = id;
+  current.last_cache = cache;
+  return cache;
+}
+
+inline void size_class_pool::release_cache(size_class_pool_cache* cache) {
+  std::lock_guard lock { mutex };
+  for (std::uint32_t i = 0; i < num_size_classes; ++i) {
+    free_list local { cache->heads[i], cache->counts[i] };
+    move_blocks(local, central[i], local.count);
+    cache->heads[i] = nullptr;
+    cache->counts[i] = 0;
+  }
+  idle_caches.push_back(cache);
+}
+
+inline void* size_class_pool::allocate_small(std::size_t sz, destroy_fn destroy) {
+  auto size_class = get_size_class(sz);
+  auto cache = get_cache();
+  if (ZEN_UNLIKELY(cache->heads[size_class] == nullptr) && !refill(*cache, size_class)) {
+    return nullptr;
+  }
+  auto block = cache->heads[size_class];
+  cache->heads[size_class] = get_next(block);
+  --cache->counts[size_class];
+  set_destroy(get_slab(block), block, destroy);
+  return block;
+}
+
+inline void size_class_pool::deallocate(void* ptr) {
+  auto s = get_slab(ptr);
+  auto destroy = get_destroy(s, ptr);
+  ZEN_ASSERT(destroy != nullptr);
+  destroy(ptr);
+  if (ZEN_UNLIKELY(s->size_class == large_size_class)) {
+    {
+      std::lock_guard lock { mutex };
+      unlink(large_slabs, s);
+    }
+    std::free(s);
+    return;
+  }
+  set_destroy(s, ptr, nullptr);
+  auto cache = get_cache();
+  auto size_class = s->size_class;
+  set_next(ptr, cache->heads[size_class]);
+  cache->heads[size_class] = ptr;
+  if (ZEN_UNLIKELY(++cache->counts[size_class] > ZEN_SIZE_CLASS_POOL_CACHE_LIMIT)) {
+    flush(*cache, size_class, ZEN_SIZE_CLASS_POOL_CACHE_LIMIT / 2);
+  }
+}
+
+inline size_class_pool::~size_class_pool() {
+  {
+    auto& registry = size_class_pool_registry::get();
+    std::lock_guard lock { registry.mutex };
+    registry.pools.erase(id);
+  }
+  for (auto list: { small_slabs, large_slabs }) {
+    while (list != nullptr) {
+      auto next = list->next;
+      for (std::size_t i = 0; i < list->num_carved; ++i) {
+        auto block = list->blocks + i * list->block_size;
+        auto destroy = get_destroy(list, block);
+        if (destroy != nullptr) {
+          destroy(block);
+        }
+      }
+      std::free(list);
+      list = next;
+    }
+  }
+  for (auto cache: caches) {
+    delete cache;
+  }
+}
+
+ZEN_NAMESPACE_END
+
+#endif // of #ifndef ZEN_SIZE_CLASS_POOL_HPP
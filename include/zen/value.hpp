@@ -1,9 +1,18 @@
 #ifndef ZEN_VALUE_HPP
 #define ZEN_VALUE_HPP
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
 #include <stack>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "zen/alloc.hpp"
 #include "zen/config.hpp"
 #include "zen/string.hpp"
 #include "zen/seq_map.hpp"
@@ -15,7 +24,7 @@ using bigint = long long;
 
 using fractional = double;
 
-enum class value_type {
+enum class value_type : std::uint8_t {
   array,
   boolean,
   string,
@@ -25,289 +34,460 @@ enum class value_type {
   object,
 };
 
-class value;
-
 class null {};
 
-class value {
+/// The maximum amount of characters that a @ref basic_value stores inline,
+/// without allocating any memory.
+#define ZEN_VALUE_INLINE_STRING_CAPACITY 14
+
+/// A dynamically typed value, such as the ones found in a JSON document.
+///
+/// A value takes up 16 bytes. Booleans, numbers and strings of at most
+/// @ref ZEN_VALUE_INLINE_STRING_CAPACITY characters are stored inside the
+/// value itself. Longer strings, arrays and objects are allocated separately
+/// and the value only holds a pointer to them. As a result, an array of small
+/// numbers or short strings is one contiguous block of memory.
+///
+/// Arrays, objects and long strings take their memory from @p Alloc. Use
+/// @ref value for values that live on the heap and @ref pool_value for values
+/// that are carved out of a @ref DynamicAllocator such as
+/// @ref growing_bump_ptr_pool, so that they can be freed all at once.
+template<typename Alloc = std::allocator<char>>
+class basic_value {
 public:
 
-  using array = std::vector<value>;
-  using object = seq_map<string, value>;
+  using allocator_type = Alloc;
 
-private:
+  template<typename T>
+  using rebind_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
 
-  value_type type;
+  using string_type = std::basic_string<char, std::char_traits<char>, rebind_alloc<char>>;
+  using array = std::vector<basic_value, rebind_alloc<basic_value>>;
+  using object = seq_map<string_type, basic_value, rebind_alloc<std::pair<string_type, basic_value>>>;
 
-  union {
-    bool b;
-    bigint i;
-    fractional f;
-    string s;
-    array a;
-    object o;
-  };
+private:
 
-public:
+  /// Marks a string whose characters are stored in @ref data. The size of the
+  /// string is stored in the last byte of @ref data.
+  static constexpr std::uint8_t inline_string_tag = 0xFF;
 
-  value():
-    type(value_type::null) {}
+  static constexpr std::size_t inline_size_offset = ZEN_VALUE_INLINE_STRING_CAPACITY;
 
-  value(null):
-    type(value_type::null) {}
+  /// Holds the boolean or number, the pointer to the string, array or object,
+  /// or the characters of an inline string.
+  alignas(8) char data[ZEN_VALUE_INLINE_STRING_CAPACITY + 1];
 
-  value(bool b):
-    type(value_type::boolean), b(b) {}
+  /// Either one of @ref value_type or @ref inline_string_tag.
+  std::uint8_t tag;
 
-  value(bigint i):
-    type(value_type::integer), i(i) {}
+  template<typename T>
+  T& get() noexcept {
+    return *std::launder(reinterpret_cast<T*>(data));
+  }
 
-  value(fractional f):
-    type(value_type::fractional), f(f) {}
+  template<typename T>
+  const T& get() const noexcept {
+    return *std::launder(reinterpret_cast<const T*>(data));
+  }
 
-  value(object o):
-    type(value_type::object), o(o) {}
+  template<typename T>
+  void set(T value) noexcept {
+    new (data) T(value);
+  }
 
-  value(array value):
-    type(value_type::array) {
-      new (&a) array(value);
+  /// Allocate a @p T using @p alloc and construct it from @p args.
+  ///
+  /// The object is not constructed through the allocator, because allocators
+  /// such as `std::pmr::polymorphic_allocator` would then try to pass
+  /// themselves to the constructor a second time.
+  template<typename T, typename A, typename ...Ts>
+  static T* make_boxed(const A& alloc, Ts&& ...args) {
+    using box_alloc = typename std::allocator_traits<A>::template rebind_alloc<T>;
+    using traits = std::allocator_traits<box_alloc>;
+    box_alloc a { alloc };
+    auto ptr = traits::allocate(a, 1);
+    try {
+      ::new (static_cast<void*>(ptr)) T(std::forward<Ts>(args)...);
+    } catch (...) {
+      traits::deallocate(a, ptr, 1);
+      throw;
+    }
+    return ptr;
+  }
+
+  template<typename T>
+  static void destroy_boxed(T* ptr) noexcept {
+    using box_alloc = typename std::allocator_traits<typename T::allocator_type>::template rebind_alloc<T>;
+    using traits = std::allocator_traits<box_alloc>;
+    box_alloc a { ptr->get_allocator() };
+    ptr->~T();
+    traits::deallocate(a, ptr, 1);
+  }
+
+  /// Store @p value inline if it is short enough and otherwise allocate a
+  /// string using @p alloc.
+  template<typename A>
+  void init_string(std::string_view value, const A& alloc) {
+    if (value.size() <= ZEN_VALUE_INLINE_STRING_CAPACITY) {
+      tag = inline_string_tag;
+      std::memcpy(data, value.data(), value.size());
+      data[inline_size_offset] = static_cast<char>(value.size());
+    } else {
+      tag = static_cast<std::uint8_t>(value_type::string);
+      set(make_boxed<string_type>(alloc, value, alloc));
     }
+  }
+
+  /// Copy a boxed payload using the same allocator as the original, so that
+  /// the copy can later be freed through its own allocator.
+  template<typename T>
+  static T* copy_boxed(const T* other) {
+    return copy_boxed(other, other->get_allocator());
+  }
 
-  value(string s):
-    type(value_type::string), s(s) { }
+  template<typename T, typename A>
+  static T* copy_boxed(const T* other, const A& alloc) {
+    return make_boxed<T>(alloc, *other, alloc);
+  }
 
-  value(const value& other): type(other.type) {
-    switch (other.type) {
-      case value_type::array:
-        new (&a) array(other.a);
-        break;
-      case value_type::object:
-        new (&o) object(other.o);
-        break;
-      case value_type::integer:
-        new (&i) bigint(other.i);
-        break;
-      case value_type::boolean:
-        b = other.b;
+  void init_copy(const basic_value& other) {
+    switch (other.tag) {
+      case static_cast<std::uint8_t>(value_type::string):
+        set(copy_boxed(other.get<string_type*>()));
         break;
-      case value_type::null:
+      case static_cast<std::uint8_t>(value_type::array):
+        set(copy_boxed(other.get<array*>()));
         break;
-      case value_type::string:
-        new (&s) string(other.s);
+      case static_cast<std::uint8_t>(value_type::object):
+        set(copy_boxed(other.get<object*>()));
         break;
-      case value_type::fractional:
-        new (&f) fractional(other.f);
+      default:
+        std::memcpy(data, other.data, sizeof(data));
         break;
     }
+    tag = other.tag;
   }
 
-  value(value&& other): type(std::move(other.type)) {
-    switch (other.type) {
-      case value_type::array:
-        new (&a) array(std::move(other.a));
+  void init_copy(const basic_value& other, const allocator_type& alloc) {
+    switch (other.tag) {
+      case static_cast<std::uint8_t>(value_type::string):
+        set(copy_boxed(other.get<string_type*>(), alloc));
         break;
-      case value_type::object:
-        new (&o) object(std::move(other.o));
+      case static_cast<std::uint8_t>(value_type::array):
+        set(copy_boxed(other.get<array*>(), alloc));
         break;
-      case value_type::integer:
-        new (&i) bigint(std::move(other.i));
+      case static_cast<std::uint8_t>(value_type::object):
+        set(copy_boxed(other.get<object*>(), alloc));
         break;
-      case value_type::boolean:
-        b = other.b;
-        break;
-      case value_type::null:
-        break;
-      case value_type::string:
-        new (&s) string(std::move(other.s));
-        break;
-      case value_type::fractional:
-        new (&f) fractional(std::move(other.f));
+      default:
+        std::memcpy(data, other.data, sizeof(data));
         break;
     }
-    other.type = value_type::null;
+    tag = other.tag;
+  }
+
+  /// Get the allocator of the payload of this value, if any.
+  std::optional<allocator_type> get_payload_allocator() const {
+    switch (tag) {
+      case static_cast<std::uint8_t>(value_type::string):
+        return allocator_type(get<string_type*>()->get_allocator());
+      case static_cast<std::uint8_t>(value_type::array):
+        return allocator_type(get<array*>()->get_allocator());
+      case static_cast<std::uint8_t>(value_type::object):
+        return allocator_type(get<object*>()->get_allocator());
+      default:
+        return {};
+    }
   }
 
-  value& operator=(const value& other) {
-    type = other.type;
-    switch (other.type) {
-      case value_type::array:
-        new (&a) array(other.a);
-        break;
-      case value_type::object:
-        new (&o) object(other.o);
-        break;
-      case value_type::integer:
-        new (&i) bigint(other.i);
-        break;
-      case value_type::boolean:
-        b = other.b;
-        break;
-      case value_type::null:
+  /// Take over the contents of @p other, which becomes null.
+  ///
+  /// Heap-allocated payloads are only referred to by a pointer, so moving a
+  /// value never allocates and never touches the payload itself.
+  void init_move(basic_value& other) noexcept {
+    std::memcpy(data, other.data, sizeof(data));
+    tag = other.tag;
+    other.tag = static_cast<std::uint8_t>(value_type::null);
+  }
+
+  void destroy() noexcept {
+    switch (tag) {
+      case static_cast<std::uint8_t>(value_type::string):
+        destroy_boxed(get<string_type*>());
         break;
-      case value_type::string:
-        new (&s) string(other.s);
+      case static_cast<std::uint8_t>(value_type::array):
+        destroy_boxed(get<array*>());
         break;
-      case value_type::fractional:
-        new (&f) fractional(other.f);
+      case static_cast<std::uint8_t>(value_type::object):
+        destroy_boxed(get<object*>());
         break;
     }
-    return *this;
   }
 
-  value& operator=(value&& other) {
-    type = std::move(other.type);
-    switch (other.type) {
-      case value_type::array:
-        new (&a) array(std::move(other.a));
-        break;
-      case value_type::object:
-        new (&o) object(std::move(other.o));
-        break;
-      case value_type::integer:
-        new (&i) bigint(std::move(other.i));
-        break;
-      case value_type::boolean:
-        b = other.b;
-        break;
-      case value_type::null:
-        break;
-      case value_type::string:
-        new (&s) string(std::move(other.s));
-        break;
-      case value_type::fractional:
-        new (&f) fractional(std::move(other.f));
-        break;
+public:
+
+  basic_value():
+    tag(static_cast<std::uint8_t>(value_type::null)) {}
+
+  basic_value(null):
+    tag(static_cast<std::uint8_t>(value_type::null)) {}
+
+  basic_value(bool b):
+    tag(static_cast<std::uint8_t>(value_type::boolean)) {
+      set(b);
+    }
+
+  basic_value(bigint i):
+    tag(static_cast<std::uint8_t>(value_type::integer)) {
+      set(i);
+    }
+
+  basic_value(fractional f):
+    tag(static_cast<std::uint8_t>(value_type::fractional)) {
+      set(f);
+    }
+
+  basic_value(object o):
+    tag(static_cast<std::uint8_t>(value_type::object)) {
+      set(make_boxed<object>(o.get_allocator(), std::move(o)));
+    }
+
+  basic_value(array a):
+    tag(static_cast<std::uint8_t>(value_type::array)) {
+      set(make_boxed<array>(a.get_allocator(), std::move(a)));
+    }
+
+  basic_value(string_type s) {
+    if (s.size() <= ZEN_VALUE_INLINE_STRING_CAPACITY) {
+      init_string(s, s.get_allocator());
+    } else {
+      tag = static_cast<std::uint8_t>(value_type::string);
+      set(make_boxed<string_type>(s.get_allocator(), std::move(s)));
     }
-    other.type = value_type::null;
-    return *this;
   }
 
-  inline ~value() {
-    switch (type) {
-      case value_type::string:
-        s.~string();
-        break;
-      case value_type::fractional:
-        f.~fractional();
-        break;
-      case value_type::array:
-        a.~array();
-        break;
-      case value_type::object:
-        o.~object();
-        break;
-      case value_type::boolean:
-        break;
-      case value_type::integer:
-        i.~bigint();
-        break;
-      case value_type::null:
-        break;
+  /// Construct a string whose characters are allocated using @p alloc if they
+  /// do not fit inside the value.
+  basic_value(std::string_view s, const allocator_type& alloc) {
+    init_string(s, alloc);
+  }
+
+  basic_value(const char* s, const allocator_type& alloc) {
+    init_string(s, alloc);
+  }
+
+  /// Construct an empty value of the given type.
+  ///
+  /// Arrays and objects that are created this way, as well as any elements
+  /// that are added to them later on, are allocated using @p alloc.
+  basic_value(value_type type, const allocator_type& alloc):
+    tag(static_cast<std::uint8_t>(type)) {
+      switch (type) {
+        case value_type::array:
+          set(make_boxed<array>(alloc, alloc));
+          break;
+        case value_type::object:
+          set(make_boxed<object>(alloc, alloc));
+          break;
+        case value_type::string:
+          init_string({}, alloc);
+          break;
+        case value_type::boolean:
+          set(false);
+          break;
+        case value_type::integer:
+          set(bigint(0));
+          break;
+        case value_type::fractional:
+          set(fractional(0));
+          break;
+        case value_type::null:
+          break;
+      }
     }
+
+  basic_value(const basic_value& other) {
+    init_copy(other);
   }
 
-  inline value_type get_type() const noexcept {
-    return type;
+  basic_value(basic_value&& other) noexcept {
+    init_move(other);
   }
 
-  inline bool& as_boolean() {
-    ZEN_ASSERT(type == value_type::boolean);
-    return b;
+  /// Copy @p other, allocating any string, array or object using @p alloc.
+  ///
+  /// Together with the constructor below, this lets containers that
+  /// propagate their allocator to their elements, such as those in
+  /// `std::pmr`, hold values.
+  basic_value(const basic_value& other, const allocator_type& alloc) {
+    init_copy(other, alloc);
   }
 
-  inline const bool& as_boolean() const {
-    ZEN_ASSERT(type == value_type::boolean);
-    return b;
+  /// Move @p other if its payload was allocated using @p alloc and copy it
+  /// using @p alloc otherwise.
+  basic_value(basic_value&& other, const allocator_type& alloc) {
+    auto payload_alloc = other.get_payload_allocator();
+    if (!payload_alloc || *payload_alloc == alloc) {
+      init_move(other);
+    } else {
+      init_copy(other, alloc);
+    }
+  }
+
+  basic_value& operator=(const basic_value& other) {
+    if (this != &other) {
+      basic_value copy { other };
+      destroy();
+      init_move(copy);
+    }
+    return *this;
   }
 
-  inline string& as_string() {
-    ZEN_ASSERT(type == value_type::string);
-    return s;
+  basic_value& operator=(basic_value&& other) noexcept {
+    if (this != &other) {
+      destroy();
+      init_move(other);
+    }
+    return *this;
   }
 
-  inline const string& as_string() const {
-    ZEN_ASSERT(type == value_type::string);
-    return s;
+  inline ~basic_value() {
+    destroy();
+  }
+
+  inline value_type get_type() const noexcept {
+    return tag == inline_string_tag ? value_type::string : static_cast<value_type>(tag);
+  }
+
+  inline bool& as_boolean() {
+    ZEN_ASSERT(is_boolean());
+    return get<bool>();
+  }
+
+  inline const bool& as_boolean() const {
+    ZEN_ASSERT(is_boolean());
+    return get<bool>();
+  }
+
+  /// Get a view of the characters of this string.
+  ///
+  /// The view remains valid for as long as this value is not modified, moved
+  /// or destroyed.
+  inline std::string_view as_string() const {
+    ZEN_ASSERT(is_string());
+    if (tag == inline_string_tag) {
+      return { data, static_cast<std::size_t>(data[inline_size_offset]) };
+    }
+    return *get<string_type*>();
   }
 
   inline bigint& as_integer() {
-    ZEN_ASSERT(type == value_type::integer);
-    return i;
+    ZEN_ASSERT(is_integer());
+    return get<bigint>();
   }
 
   inline const bigint& as_integer() const {
-    ZEN_ASSERT(type == value_type::integer);
-    return i;
+    ZEN_ASSERT(is_integer());
+    return get<bigint>();
   }
 
   inline fractional& as_fractional() {
-    ZEN_ASSERT(type == value_type::fractional);
-    return f;
+    ZEN_ASSERT(is_fractional());
+    return get<fractional>();
   }
 
   inline const fractional& as_fractional() const {
-    ZEN_ASSERT(type == value_type::fractional);
-    return f;
+    ZEN_ASSERT(is_fractional());
+    return get<fractional>();
   }
 
   inline array& as_array() {
-    ZEN_ASSERT(type == value_type::array);
-    return a;
+    ZEN_ASSERT(is_array());
+    return *get<array*>();
   }
 
   inline const array& as_array() const {
-    ZEN_ASSERT(type == value_type::array);
-    return a;
+    ZEN_ASSERT(is_array());
+    return *get<array*>();
   }
 
   inline object& as_object() {
-    ZEN_ASSERT(type == value_type::object);
-    return o;
+    ZEN_ASSERT(is_object());
+    return *get<object*>();
   }
 
   inline const object& as_object() const {
-    ZEN_ASSERT(type == value_type::object);
-    return o;
+    ZEN_ASSERT(is_object());
+    return *get<object*>();
   }
 
   inline bool is_true() const noexcept {
-    return type == value_type::boolean && b;
+    return is_boolean() && get<bool>();
   }
 
   inline bool is_false() const noexcept {
-    return type == value_type::boolean && !b;
+    return is_boolean() && !get<bool>();
   }
 
   inline bool is_boolean() const noexcept {
-    return type == value_type::boolean;
+    return tag == static_cast<std::uint8_t>(value_type::boolean);
   }
 
   inline bool is_integer() const noexcept {
-    return type == value_type::integer;
+    return tag == static_cast<std::uint8_t>(value_type::integer);
   }
 
   inline bool is_fractional() const noexcept {
-    return type == value_type::fractional;
+    return tag == static_cast<std::uint8_t>(value_type::fractional);
   }
 
   inline bool is_null() const noexcept {
-    return type == value_type::null;
+    return tag == static_cast<std::uint8_t>(value_type::null);
   }
 
   inline bool is_string() const noexcept {
-    return type == value_type::string;
+    return tag == inline_string_tag || tag == static_cast<std::uint8_t>(value_type::string);
   }
 
   inline bool is_object() const noexcept {
-    return type == value_type::object;
+    return tag == static_cast<std::uint8_t>(value_type::object);
   }
 
   inline bool is_array() const noexcept {
-    return type == value_type::array;
+    return tag == static_cast<std::uint8_t>(value_type::array);
   }
 
 };
 
+/// A value that allocates its arrays, objects and strings on the heap.
+using value = basic_value<>;
+
+/// A value that allocates its arrays, objects and strings inside a
+/// @ref DynamicAllocator.
+///
+/// Deallocating a pool value does not give any memory back; everything is
+/// released at once when the pool is destroyed.
+///
+/// ```
+/// zen::growing_bump_ptr_pool pool;
+/// zen::pool_value names { zen::value_type::array, pool };
+/// names.as_array().push_back(zen::pool_value("Bob", pool));
+/// ```
+using pool_value = basic_value<pool_allocator<char>>;
+
+/// A value that allocates its arrays, objects and strings from a
+/// `std::pmr::memory_resource`, such as a @ref pool_resource.
+///
+/// ```
+/// zen::pool_resource arena;
+/// zen::pmr_value names { zen::value_type::array, &arena };
+/// ```
+using pmr_value = basic_value<std::pmr::polymorphic_allocator<char>>;
+
+static_assert(sizeof(value) == 16);
+static_assert(sizeof(pool_value) == 16);
+static_assert(sizeof(pmr_value) == 16);
+
 using array = value::array;
 using object = value::object;
 
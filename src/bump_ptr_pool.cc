@@ -0,0 +1,82 @@
+
+#ifdef __unix__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <new>
+
+#include "zen/bump_ptr_pool.hpp"
+
+ZEN_NAMESPACE_START
+
+#define ZEN_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#ifdef __unix__
+
+static std::size_t get_page_size() {
+  static const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+
+static std::size_t get_mapped_size(std::size_t sz, pool_backing backing) {
+  auto align = backing == pool_backing::huge_pages ? ZEN_HUGE_PAGE_SIZE : get_page_size();
+  return (sz + align - 1) & ~(align - 1);
+}
+
+static std::byte* map_chunk(std::size_t sz, pool_backing backing) {
+  auto mapped_size = get_mapped_size(sz, backing);
+  if (backing == pool_backing::mapped) {
+    auto ptr = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<std::byte*>(ptr);
+  }
+  // Map a huge page more than needed and cut off whatever lies outside of
+  // the first huge page boundary.
+  auto ptr = ::mmap(nullptr, mapped_size + ZEN_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return nullptr;
+  }
+  auto start = reinterpret_cast<std::uintptr_t>(ptr);
+  auto aligned = (start + ZEN_HUGE_PAGE_SIZE - 1) & ~std::uintptr_t(ZEN_HUGE_PAGE_SIZE - 1);
+  if (aligned > start) {
+    ::munmap(ptr, aligned - start);
+  }
+  auto tail = start + ZEN_HUGE_PAGE_SIZE - aligned;
+  if (tail > 0) {
+    ::munmap(reinterpret_cast<void*>(aligned + mapped_size), tail);
+  }
+#ifdef MADV_HUGEPAGE
+  // This is only a hint. The chunk is still usable if the kernel does not
+  // support transparent huge pages.
+  ::madvise(reinterpret_cast<void*>(aligned), mapped_size, MADV_HUGEPAGE);
+#endif
+  return reinterpret_cast<std::byte*>(aligned);
+}
+
+#endif
+
+std::byte* allocate_pool_chunk(std::size_t sz, pool_backing& backing) {
+#ifdef __unix__
+  if (backing != pool_backing::heap) {
+    auto ptr = map_chunk(sz, backing);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+#endif
+  backing = pool_backing::heap;
+  return new std::byte[sz];
+}
+
+void free_pool_chunk(std::byte* ptr, std::size_t sz, pool_backing backing) noexcept {
+#ifdef __unix__
+  if (backing != pool_backing::heap) {
+    ::munmap(ptr, get_mapped_size(sz, backing));
+    return;
+  }
+#endif
+  delete[] ptr;
+}
+
+ZEN_NAMESPACE_END
@@ -3,6 +3,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #else
 #error "unsupported platform"
@@ -10,21 +11,31 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 
 #include "zen/fs/io.hpp"
 
 ZEN_NAMESPACE_START
 
-#define ZEN_FILE_BUFFER_SIZE 4096
-
 namespace fs {
 
 static std::error_code wrap_system_error(int code) {
   return std::error_code { code, std::system_category() };
 }
-                                                                                          ;
-either<std::error_code, bytestring> read_file(const path& filename) {
+/// Call `read()` until it succeeds or fails with something other than
+/// `EINTR`.
+static ssize_t read_some(int fd, char* data, std::size_t size) {
+  for (;;) {
+    auto count = read(fd, data, size);
+    if (count != -1 || errno != EINTR) {
+      return count;
+    }
+  }
+}
+
+either<std::error_code, bytestring> read_file(const path& filename, read_file_opts opts) {
 
   auto fd = open(filename.c_str(), O_RDONLY);
   if (fd == -1) {
@@ -34,41 +45,129 @@ either<std::error_code, bytestring> read_file(const path& filename) {
   struct stat s;
 
   if (fstat(fd, &s) == -1) {
+    auto code = errno;
     close(fd);
-    return left(wrap_system_error(errno));
+    return left(wrap_system_error(code));
   }
 
-  if (s.st_size >= std::numeric_limits<std::size_t>::max()) {
+  if (static_cast<std::uintmax_t>(s.st_size) >= std::numeric_limits<std::size_t>::max()) {
     close(fd);
     return left(wrap_system_error(EOVERFLOW));
   }
 
-  char buffer[ZEN_FILE_BUFFER_SIZE];
+#ifdef POSIX_FADV_SEQUENTIAL
+  if (opts.sequential) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+#endif
 
-  auto chars = (char*)malloc(s.st_size);
-  if (chars == NULL) {
-    close(fd);
-    return left(wrap_system_error(ENOMEM));
+  auto block_size = std::max<std::size_t>(opts.block_size, 1);
+
+  // Files such as those in /proc report a size of zero even though they are
+  // not empty. Reading a single byte tells them apart from files that are
+  // really empty, which then do not need a buffer at all.
+  char first;
+  ssize_t first_count = 0;
+  if (s.st_size == 0) {
+    first_count = read_some(fd, &first, 1);
+    if (first_count == -1) {
+      auto code = errno;
+      close(fd);
+      return left(wrap_system_error(code));
+    }
+    if (first_count == 0) {
+      close(fd);
+      bytestring empty { std::size_t(1) };
+      empty.resize(0);
+      return right(std::move(empty));
+    }
   }
 
-  auto ptr = chars;
+  // Files of unknown size start out small and grow as needed.
+  bytestring out { s.st_size > 0 ? static_cast<std::size_t>(s.st_size) : std::min<std::size_t>(block_size, 4096) };
+  std::size_t size = 0;
+  if (first_count == 1) {
+    out.data()[size++] = first;
+  }
 
   for (;;) {
-    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if (size == out.capacity()) {
+      // The file should end here, unless it grew since it was stat'ed.
+      char probe;
+      auto count = read_some(fd, &probe, 1);
+      if (count == -1) {
+        auto code = errno;
+        close(fd);
+        return left(wrap_system_error(code));
+      }
+      if (count == 0) {
+        break;
+      }
+      out.reserve(std::max(out.capacity() * 2, out.capacity() + block_size));
+      out.data()[size++] = probe;
+    }
+    auto count = read_some(fd, out.data() + size, std::min(block_size, out.capacity() - size));
     if (count == -1) {
+      auto code = errno;
       close(fd);
-      return left(wrap_system_error(errno));
+      return left(wrap_system_error(code));
     }
     if (count == 0) {
       break;
     }
-    memcpy(ptr, buffer, count);
-    ptr += count;
+    size += count;
+  }
+
+  close(fd);
+
+  out.resize(size);
+  return right(std::move(out));
+}
+
+mapped_file::~mapped_file() {
+  if (ptr != nullptr) {
+    munmap(const_cast<char*>(ptr), sz);
   }
+}
+
+either<std::error_code, mapped_file> map_file(const path& filename, map_file_opts opts) {
 
+  auto fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return left(wrap_system_error(errno));
+  }
+
+  struct stat s;
+
+  if (fstat(fd, &s) == -1) {
+    auto code = errno;
+    close(fd);
+    return left(wrap_system_error(code));
+  }
+
+  std::size_t size = s.st_size;
+  if (size == 0) {
+    close(fd);
+    return right(mapped_file {});
+  }
+
+  // The mapping keeps its own reference to the file, so the descriptor is
+  // not needed anymore once it exists.
+  auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  auto code = errno;
   close(fd);
+  if (data == MAP_FAILED) {
+    return left(wrap_system_error(code));
+  }
+
+  if (opts.sequential) {
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  if (opts.will_need) {
+    madvise(data, size, MADV_WILLNEED);
+  }
 
-  return right(bytestring { chars, static_cast<unsigned long>(ptr - chars) });
+  return right(mapped_file { static_cast<const char*>(data), size });
 }
 
 }
@@ -1,5 +1,10 @@
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <cmath>
@@ -10,94 +15,333 @@
 #include "zen/config.hpp"
 #include "zen/transformer.hpp"
 #include "zen/json.hpp"
+#include "zen/json_document.hpp"
+#include "zen/json_ondemand.hpp"
+#include "zen/output_sink.hpp"
 #include "zen/stream.hpp"
 #include "zen/either.hpp"
 #include "zen/value.hpp"
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ZEN_JSON_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define ZEN_JSON_HAVE_X86_KERNELS 0
+#endif
+
 ZEN_NAMESPACE_START
 
-static void print_json_string(const string& str, std::ostream& out) {
-  out << '"';
-  for (auto ch: str) {
-    // FIXME This should be UTF-8-encoded
-    out << ch;
+/// For every byte, whether it needs to be escaped inside a JSON string or is
+/// part of a multi-byte UTF-8 sequence.
+struct json_escape_table {
+
+  bool is_special[256] = {};
+
+  constexpr json_escape_table() {
+    for (std::size_t i = 0; i < 0x20; ++i) {
+      is_special[i] = true;
+    }
+    for (std::size_t i = 0x80; i < 0x100; ++i) {
+      is_special[i] = true;
+    }
+    is_special[static_cast<unsigned char>('"')] = true;
+    is_special[static_cast<unsigned char>('\\')] = true;
+  }
+
+};
+
+static constexpr json_escape_table escape_table;
+
+static void write_json_escape(output_sink& out, char ch) {
+  switch (ch) {
+    case '"':
+      out.write("\\\"", 2);
+      break;
+    case '\\':
+      out.write("\\\\", 2);
+      break;
+    case '\b':
+      out.write("\\b", 2);
+      break;
+    case '\f':
+      out.write("\\f", 2);
+      break;
+    case '\n':
+      out.write("\\n", 2);
+      break;
+    case '\r':
+      out.write("\\r", 2);
+      break;
+    case '\t':
+      out.write("\\t", 2);
+      break;
+    default:
+    {
+      static constexpr char hex_digits[] = "0123456789abcdef";
+      auto ptr = out.reserve(6);
+      ptr[0] = '\\';
+      ptr[1] = 'u';
+      ptr[2] = '0';
+      ptr[3] = '0';
+      ptr[4] = hex_digits[static_cast<unsigned char>(ch) >> 4];
+      ptr[5] = hex_digits[static_cast<unsigned char>(ch) & 0xF];
+      out.commit(6);
+      break;
+    }
+  }
+}
+
+using find_special_fn = const char* (*)(const char* ptr, const char* end);
+
+/// Find the first byte that needs to be escaped or that is not ASCII, one
+/// byte at a time.
+static const char* find_special_scalar(const char* ptr, const char* end) {
+  while (ptr != end && !escape_table.is_special[static_cast<unsigned char>(*ptr)]) {
+    ++ptr;
+  }
+  return ptr;
+}
+
+#if ZEN_JSON_HAVE_X86_KERNELS
+
+// A byte is special when it is a quote, a backslash, a control character or
+// when its high bit is set. Control characters are found by checking whether
+// the byte is left untouched by an unsigned minimum with 0x1F.
+
+__attribute__((target("sse2")))
+static const char* find_special_sse2(const char* ptr, const char* end) {
+  const __m128i quote_char = _mm_set1_epi8('"');
+  const __m128i backslash_char = _mm_set1_epi8('\\');
+  const __m128i max_control = _mm_set1_epi8(0x1F);
+  while (end - ptr >= 16) {
+    auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    auto is_escaped = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(in, quote_char), _mm_cmpeq_epi8(in, backslash_char)),
+      _mm_cmpeq_epi8(_mm_min_epu8(in, max_control), in)
+    );
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(is_escaped, in)));
+    if (mask != 0) {
+      return ptr + std::countr_zero(mask);
+    }
+    ptr += 16;
+  }
+  return find_special_scalar(ptr, end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_special_avx2(const char* ptr, const char* end) {
+  const __m256i quote_char = _mm256_set1_epi8('"');
+  const __m256i backslash_char = _mm256_set1_epi8('\\');
+  const __m256i max_control = _mm256_set1_epi8(0x1F);
+  while (end - ptr >= 32) {
+    auto in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    auto is_escaped = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(in, quote_char), _mm256_cmpeq_epi8(in, backslash_char)),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(in, max_control), in)
+    );
+    auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(is_escaped, in)));
+    if (mask != 0) {
+      return ptr + std::countr_zero(mask);
+    }
+    ptr += 32;
+  }
+  return find_special_sse2(ptr, end);
+}
+
+#endif // of #if ZEN_JSON_HAVE_X86_KERNELS
+
+static find_special_fn select_find_special() {
+#if ZEN_JSON_HAVE_X86_KERNELS
+  if (__builtin_cpu_supports("avx2")) {
+    return find_special_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return find_special_sse2;
+  }
+#endif
+  return find_special_scalar;
+}
+
+static const find_special_fn find_special = select_find_special();
+
+/// Get the length of the well-formed UTF-8 sequence at the start of the
+/// given range, or zero if there is none.
+///
+/// Overlong encodings, surrogates and code points beyond U+10FFFF are not
+/// well-formed.
+static std::size_t get_utf8_sequence_length(const char* ptr, const char* end) {
+  auto available = end - ptr;
+  auto byte = [&](std::size_t i) { return static_cast<unsigned char>(ptr[i]); };
+  auto is_continuation = [&](std::size_t i) { return (byte(i) & 0xC0) == 0x80; };
+  auto c0 = byte(0);
+  if (c0 >= 0xC2 && c0 <= 0xDF) {
+    return available >= 2 && is_continuation(1) ? 2 : 0;
+  }
+  if (c0 >= 0xE0 && c0 <= 0xEF) {
+    if (available < 3 || !is_continuation(1) || !is_continuation(2)) {
+      return 0;
+    }
+    if ((c0 == 0xE0 && byte(1) < 0xA0) || (c0 == 0xED && byte(1) > 0x9F)) {
+      return 0;
+    }
+    return 3;
   }
-  out << '"';
+  if (c0 >= 0xF0 && c0 <= 0xF4) {
+    if (available < 4 || !is_continuation(1) || !is_continuation(2) || !is_continuation(3)) {
+      return 0;
+    }
+    if ((c0 == 0xF0 && byte(1) < 0x90) || (c0 == 0xF4 && byte(1) > 0x8F)) {
+      return 0;
+    }
+    return 4;
+  }
+  return 0;
+}
+
+/// Write a string surrounded by quotes, escaping any characters that may not
+/// appear as-is in a JSON string.
+///
+/// The input is scanned 16 or 32 bytes at a time for quotes, backslashes,
+/// control characters and non-ASCII bytes, and everything in between is copied
+/// in one go. Non-ASCII text is validated as UTF-8; bytes that are not part of
+/// a well-formed sequence are replaced with U+FFFD so that the output is
+/// always valid JSON.
+static void write_json_string(output_sink& out, std::string_view str) {
+  out.put('"');
+  auto ptr = str.data();
+  auto end = ptr + str.size();
+  for (;;) {
+    auto run_start = ptr;
+    ptr = find_special(ptr, end);
+    while (ptr != end && static_cast<unsigned char>(*ptr) >= 0x80) {
+      auto length = get_utf8_sequence_length(ptr, end);
+      if (ZEN_UNLIKELY(length == 0)) {
+        out.write(run_start, ptr - run_start);
+        out.write("\\ufffd", 6);
+        run_start = ++ptr;
+      } else {
+        ptr += length;
+      }
+      ptr = find_special(ptr, end);
+    }
+    out.write(run_start, ptr - run_start);
+    if (ptr == end) {
+      break;
+    }
+    write_json_escape(out, *ptr++);
+  }
+  out.put('"');
+}
+
+/// Write a floating-point number such that it is read back as a fractional.
+///
+/// The number is written using the fewest digits that still parse back to
+/// exactly the same value, as computed by `std::to_chars` without a precision.
+/// Unlike `std::ostream`, this does not depend on the current locale and does
+/// not lose precision after six digits.
+///
+/// JSON has no way to represent infinity or NaN, so these are written as
+/// `null`.
+template<typename T>
+static void write_json_fractional(output_sink& out, T value) {
+  if (!std::isfinite(value)) {
+    out.write("null", 4);
+    return;
+  }
+  auto ptr = out.reserve(32);
+  auto [end, _] = std::to_chars(ptr, ptr + 32, value);
+  if (std::find_if(ptr, end, [](char ch) { return ch == '.' || ch == 'e'; }) == end) {
+    *end++ = '.';
+    *end++ = '0';
+  }
+  out.commit(end - ptr);
+}
+
+static void write_indent(output_sink& out, int indent) {
+  auto ptr = out.reserve(indent);
+  std::memset(ptr, ' ', indent);
+  out.commit(indent);
 }
 
-static void print_impl(const value &v, std::ostream& out, int indent) {
+static void print_impl(const value &v, output_sink& out, int indent) {
 
   switch (v.get_type()) {
 
     case value_type::array:
     {
-      auto array = v.as_array();
+      auto& array = v.as_array();
       if (array.empty()) {
-        out << "[]";
+        out.write("[]", 2);
         break;
       }
-      out << "[\n";
+      out.write("[\n", 2);
       auto curr = array.cbegin();
       auto end = array.cend();
       if (curr != end) {
         auto new_indent = indent + 2;
-        out << std::string(indent + 2, ' ');
+        write_indent(out, new_indent);
         print_impl(*curr, out, new_indent);
         curr++;
         for (; curr != end; curr++) {
-          out << ",\n" << std::string(indent + 2, ' ');
-          print_impl(*curr, out, indent + 2);
+          out.write(",\n", 2);
+          write_indent(out, new_indent);
+          print_impl(*curr, out, new_indent);
         }
       }
-      out << "\n" << std::string(indent, ' ') << "]";
+      out.put('\n');
+      write_indent(out, indent);
+      out.put(']');
       break;
     }
 
     case value_type::boolean:
-      out << (v.is_true() ? "true" : "false");
+      out.write(v.is_true() ? "true" : "false");
       break;
 
     case value_type::string:
-      print_json_string(v.as_string(), out);
+      write_json_string(out, v.as_string());
       break;
 
     case value_type::null:
-      out << "null";
+      out.write("null", 4);
       break;
 
     case value_type::fractional:
-      out << v.as_fractional();
+      write_json_fractional(out, v.as_fractional());
       break;
 
     case value_type::integer:
-      out << v.as_integer();
+      out.write_integer(v.as_integer());
       break;
 
     case value_type::object:
     {
-      auto object = v.as_object();
+      auto& object = v.as_object();
       if (object.empty()) {
-        out << "{}";
+        out.write("{}", 2);
         break;
       }
-      out << "{\n";
+      out.write("{\n", 2);
       auto curr = object.cbegin();
       auto end = object.cend();
       if (curr != end) {
         auto new_indent = indent + 2;
-        out << std::string(new_indent, ' ');
-        print_json_string(curr->first, out);
-        out << ": ";
+        write_indent(out, new_indent);
+        write_json_string(out, curr->first);
+        out.write(": ", 2);
         print_impl(curr->second, out, new_indent);
         curr++;
         for (; curr != end; curr++) {
-          out << ",\n" << std::string(new_indent, ' ');
-          print_json_string(curr->first, out);
-          out << ": ";
+          out.write(",\n", 2);
+          write_indent(out, new_indent);
+          write_json_string(out, curr->first);
+          out.write(": ", 2);
           print_impl(curr->second, out, new_indent);
         }
       }
-      out << "\n" << std::string(indent, ' ') << "}";
+      out.put('\n');
+      write_indent(out, indent);
+      out.put('}');
       break;
     }
 
@@ -106,7 +350,8 @@ static void print_impl(const value &v, std::ostream& out, int indent) {
 }
 
 void print(const value &v, std::ostream& out) {
-  print_impl(v, out, 0);
+  ostream_sink sink { out };
+  print_impl(v, sink, 0);
 }
 
 std::string to_string(const value& v) {
@@ -115,142 +360,142 @@ std::string to_string(const value& v) {
   return ss.str();
 }
 
-std::string escape_char(char ch) {
-  switch (ch) {
-    case '\"': return "\\\"";
-    case '\\': return "\\\\";
-    // case '/': return "\/";
-    case '\b': return "\\b";
-    case '\f': return "\\f";
-    case '\n': return "\\n";
-    case '\r': return "\\r";
-    case '\t': return "\\t";
-    default: return std::string { ch };
-  }
-}
-
 class json_encoder : public transformer {
 
   std::stack<bool> levels;
   std::string indentation;
 
-  std::ostream& out;
+  std::unique_ptr<output_sink> owned_out;
+  output_sink& out;
 
   void write_indentation(int count) {
     for (auto i = 0; i < count; ++i) {
-      out << indentation;
+      out.write(indentation);
     }
   }
 
-  void write_string(const std::string& str) {
-    out << '"';
-    for (auto ch: str) {
-      out << escape_char(ch);
+  /// Make a complete document visible to the destination as soon as it has
+  /// been written.
+  void finish_value() {
+    if (levels.empty()) {
+      out.flush_buffer();
     }
-    out << '"';
   }
 
 public:
 
-  json_encoder(std::ostream& out, std::string indentation):
+  json_encoder(output_sink& out, std::string indentation):
     indentation(indentation), out(out) {}
 
+  json_encoder(std::unique_ptr<output_sink> owned_out, std::string indentation):
+    indentation(indentation), owned_out(std::move(owned_out)), out(*this->owned_out) {}
+
   void transform(bool& v) override {
-    out << (v ? "true" : "false");
+    if (v) {
+      out.write("true", 4);
+    } else {
+      out.write("false", 5);
+    }
+    finish_value();
   }
 
   void transform(char& v) override {
-    out << '"' << escape_char(v) << '"';
+    write_json_string(out, std::string_view { &v, 1 });
+    finish_value();
   }
 
   void transform(short& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(int& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(long& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(long long& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(unsigned char& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(unsigned short& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(unsigned int& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(unsigned long& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(unsigned long long& v) override {
-    out << v;
+    out.write_integer(v);
+    finish_value();
   }
 
   void transform(float& v) override {
-    float integral;
-    if (std::modf(v, &integral) == 0) {
-      out << integral << ".0";
-    } else {
-      out << v << v;
-    }
+    write_json_fractional(out, v);
+    finish_value();
   }
 
   void transform(double& v) override {
-    double integral;
-    if (std::modf(v, &integral) == 0) {
-      out << integral << ".0";
-    } else {
-      out << v << v;
-    }
+    write_json_fractional(out, v);
+    finish_value();
   }
 
   void transform(std::string& v) override {
-    write_string(v);
+    write_json_string(out, v);
+    finish_value();
   }
 
   void start_transform_object(const std::string& tag_name) override {
-    out << "{\n";
+    out.write("{\n", 2);
     levels.push(false);
     write_indentation(levels.size());
-    out << "\"__tag\": \"" << tag_name << "\"";
+    out.write("\"__tag\": ");
+    write_json_string(out, tag_name);
   }
 
   void end_transform_object() override {
     levels.pop();
     if (!indentation.empty()) {
-      out << "\n";
+      out.put('\n');
       write_indentation(levels.size());
     }
-    out << "}";
+    out.put('}');
+    finish_value();
   }
 
   void start_transform_field(const std::string& name) override {
     if (!levels.top()) {
-      out << ",";
+      out.put(',');
     } else {
       levels.top() = false;
     }
     if (!indentation.empty()) {
-      out << "\n";
+      out.put('\n');
       write_indentation(levels.size());
     }
-    write_string(name);
-    out << ":";
+    write_json_string(out, name);
+    out.put(':');
     if (!indentation.empty()) {
-      out << " ";
+      out.put(' ');
     }
   }
 
@@ -260,12 +505,12 @@ public:
 
   void start_transform_element() override {
     if (!levels.top()) {
-      out << ",";
+      out.put(',');
     } else {
       levels.top() = false;
     }
     if (!indentation.empty()) {
-      out << "\n";
+      out.put('\n');
       write_indentation(levels.size());
     }
   }
@@ -287,20 +532,22 @@ public:
 
   void start_transform_sequence() override {
     levels.push(true);
-    out << "[";
+    out.put('[');
   }
 
   void end_transform_sequence() override {
     levels.pop();
     if (!indentation.empty()) {
-      out << "\n";
+      out.put('\n');
       write_indentation(levels.size());
     }
-    out << "]";
+    out.put(']');
+    finish_value();
   }
 
   void transform_nil() override {
-    out << "null";
+    out.write("null", 4);
+    finish_value();
   }
 
   void transform_size(std::size_t size) override {
@@ -308,7 +555,7 @@ public:
   }
 
   ~json_encoder() {
-
+    out.flush_buffer();
   }
 
 };
@@ -316,6 +563,13 @@ public:
 std::unique_ptr<transformer> make_json_encoder(
   std::ostream& out,
   json_encode_opts opts
+) {
+  return std::make_unique<json_encoder>(std::make_unique<ostream_sink>(out), opts.indentation);
+}
+
+std::unique_ptr<transformer> make_json_encoder(
+  output_sink& out,
+  json_encode_opts opts
 ) {
   return std::make_unique<json_encoder>(out, opts.indentation);
 }
@@ -350,11 +604,341 @@ static bool is_json_digit(char ch) {
   }
 }
 
+static bool is_json_boundary(const char* ptr, const char* end) {
+  if (ptr == end) {
+    return true;
+  }
+  switch (*ptr) {
+    case ' ':
+    case '\n':
+    case '\r':
+    case '\t':
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+      return true;
+    default:
+      return false;
+  }
+}
+
+static int parse_hex_digit(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  }
+  if (ch >= 'A' && ch <= 'F') {
+    return ch - 'A' + 10;
+  }
+  return -1;
+}
+
+static either<json_parse_error, void> scan_json_hex4(const char*& ptr, const char* end, char32_t& out) {
+  if (end - ptr < 4) {
+    return left(json_parse_error::unexpected_end_of_input);
+  }
+  out = 0;
+  for (auto i = 0; i < 4; ++i) {
+    auto digit = parse_hex_digit(*ptr++);
+    if (digit < 0) {
+      return left(json_parse_error::unrecognised_escape_sequence);
+    }
+    out = out * 16 + digit;
+  }
+  return right();
+}
+
+template<typename OutT>
+static void append_utf8(OutT& out, char32_t code_point) {
+  if (code_point < 0x80) {
+    out.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+/// Decode the contents of a string, starting right after the opening quote.
+///
+/// On success, @p ptr points right after the closing quote. Runs of characters
+/// that do not need to be unescaped are copied in one go.
+///
+/// The output only needs to provide `append(first, last)` and `push_back(ch)`,
+/// so that strings can be decoded into a buffer that is not a @ref string.
+template<typename OutT>
+static either<json_parse_error, void> scan_json_string(const char*& ptr, const char* end, OutT& out) {
+  for (;;) {
+    auto run_start = ptr;
+    while (ptr != end && *ptr != '"' && *ptr != '\\' && static_cast<unsigned char>(*ptr) >= 0x20) {
+      ++ptr;
+    }
+    out.append(run_start, ptr);
+    if (ptr == end) {
+      return left(json_parse_error::unexpected_end_of_input);
+    }
+    auto c0 = *ptr++;
+    if (c0 == '"') {
+      return right();
+    }
+    if (c0 != '\\') {
+      return left(json_parse_error::unexpected_character);
+    }
+    if (ptr == end) {
+      return left(json_parse_error::unexpected_end_of_input);
+    }
+    switch (*ptr++) {
+      case '"':
+        out.push_back('"');
+        break;
+      case '\\':
+        out.push_back('\\');
+        break;
+      case '/':
+        out.push_back('/');
+        break;
+      case 'b':
+        out.push_back('\b');
+        break;
+      case 'f':
+        out.push_back('\f');
+        break;
+      case 'n':
+        out.push_back('\n');
+        break;
+      case 'r':
+        out.push_back('\r');
+        break;
+      case 't':
+        out.push_back('\t');
+        break;
+      case 'u':
+      {
+        char32_t code_point;
+        ZEN_TRY_DISCARD(scan_json_hex4(ptr, end, code_point));
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+          if (end - ptr < 2 || ptr[0] != '\\' || ptr[1] != 'u') {
+            return left(json_parse_error::unrecognised_escape_sequence);
+          }
+          ptr += 2;
+          char32_t low;
+          ZEN_TRY_DISCARD(scan_json_hex4(ptr, end, low));
+          if (low < 0xDC00 || low > 0xDFFF) {
+            return left(json_parse_error::unrecognised_escape_sequence);
+          }
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+        } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+          return left(json_parse_error::unrecognised_escape_sequence);
+        }
+        append_utf8(out, code_point);
+        break;
+      }
+      default:
+        return left(json_parse_error::unrecognised_escape_sequence);
+    }
+  }
+}
+
+/// A number as it was found in a JSON text.
+struct json_number {
+  bool is_integer;
+  bigint integer;
+  fractional fraction;
+};
+
+static std::uint64_t load_eight_bytes(const char* ptr) {
+  std::uint64_t chunk;
+  std::memcpy(&chunk, ptr, sizeof(chunk));
+  if constexpr (std::endian::native == std::endian::big) {
+    chunk = __builtin_bswap64(chunk);
+  }
+  return chunk;
+}
+
+/// Check whether all of the eight bytes that were loaded are decimal digits.
+static bool is_eight_digits(std::uint64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0ULL)
+       | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+      == 0x3333333333333333ULL;
+}
+
+/// Convert eight decimal digits to an integer in three multiplications
+/// instead of eight, by combining neighbouring digits within the register.
+static std::uint32_t parse_eight_digits(std::uint64_t chunk) {
+  const std::uint64_t mask = 0x000000FF000000FFULL;
+  const std::uint64_t mul1 = 100 + (1000000ULL << 32);
+  const std::uint64_t mul2 = 1 + (10000ULL << 32);
+  chunk -= 0x3030303030303030ULL;
+  chunk = chunk * 10 + (chunk >> 8);
+  chunk = ((chunk & mask) * mul1 + ((chunk >> 16) & mask) * mul2) >> 32;
+  return static_cast<std::uint32_t>(chunk);
+}
+
+/// Scan a run of decimal digits, accumulating them in @p mantissa.
+///
+/// The mantissa silently wraps around when there are more than 19 digits; the
+/// caller is expected to check the amount of digits that was scanned.
+static void scan_json_digits(const char*& ptr, const char* end, std::uint64_t& mantissa) {
+  while (end - ptr >= 8) {
+    auto chunk = load_eight_bytes(ptr);
+    if (!is_eight_digits(chunk)) {
+      break;
+    }
+    mantissa = mantissa * 100000000 + parse_eight_digits(chunk);
+    ptr += 8;
+  }
+  while (ptr != end && is_json_digit(*ptr)) {
+    mantissa = mantissa * 10 + parse_decimal_digit(*ptr);
+    ++ptr;
+  }
+}
+
+/// The powers of ten that can be represented exactly by a double.
+static constexpr fractional exact_powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/// The largest integer below which every integer can be represented exactly
+/// by a double.
+#define ZEN_JSON_MAX_EXACT_MANTISSA (std::uint64_t(1) << 53)
+
+/// The largest amount of digits that always fits in a 64-bit mantissa.
+#define ZEN_JSON_MAX_MANTISSA_DIGITS 19
+
+/// Scan a number that follows the JSON grammar.
+///
+/// Numbers without a fraction or an exponent become an integer; all other
+/// numbers become a fractional. Integers that do not fit in a @ref bigint are
+/// rejected with json_parse_error::number_out_of_range.
+///
+/// Digits are consumed eight at a time where possible. A fractional is
+/// computed directly when both its digits and its power of ten are exactly
+/// representable, which makes the result correctly rounded. All other
+/// fractionals are handed to `std::from_chars`, which is correctly rounded as
+/// well.
+static either<json_parse_error, json_number> scan_json_number(const char*& ptr, const char* end) {
+
+  auto start = ptr;
+  bool negative = false;
+  if (ptr != end && *ptr == '-') {
+    negative = true;
+    ++ptr;
+  }
+  if (ptr == end) {
+    return left(json_parse_error::unexpected_end_of_input);
+  }
+  if (!is_json_digit(*ptr)) {
+    return left(json_parse_error::unexpected_character);
+  }
+
+  std::uint64_t mantissa = 0;
+  auto integer_start = ptr;
+  if (*ptr == '0') {
+    ++ptr;
+  } else {
+    scan_json_digits(ptr, end, mantissa);
+  }
+  std::size_t integer_digits = ptr - integer_start;
+
+  std::size_t fraction_digits = 0;
+  bool is_integer = true;
+  if (ptr != end && *ptr == '.') {
+    is_integer = false;
+    ++ptr;
+    if (ptr == end || !is_json_digit(*ptr)) {
+      return left(json_parse_error::unexpected_character);
+    }
+    auto fraction_start = ptr;
+    scan_json_digits(ptr, end, mantissa);
+    fraction_digits = ptr - fraction_start;
+  }
+
+  std::int64_t exponent = 0;
+  if (ptr != end && (*ptr == 'e' || *ptr == 'E')) {
+    is_integer = false;
+    ++ptr;
+    bool negative_exponent = false;
+    if (ptr != end && (*ptr == '+' || *ptr == '-')) {
+      negative_exponent = *ptr == '-';
+      ++ptr;
+    }
+    if (ptr == end || !is_json_digit(*ptr)) {
+      return left(json_parse_error::unexpected_character);
+    }
+    while (ptr != end && is_json_digit(*ptr)) {
+      // Exponents this large saturate a double either way
+      if (exponent < 1000000) {
+        exponent = exponent * 10 + parse_decimal_digit(*ptr);
+      }
+      ++ptr;
+    }
+    if (negative_exponent) {
+      exponent = -exponent;
+    }
+  }
+
+  if (is_integer) {
+    if (integer_digits > ZEN_JSON_MAX_MANTISSA_DIGITS) {
+      return left(json_parse_error::number_out_of_range);
+    }
+    auto limit = static_cast<std::uint64_t>(std::numeric_limits<bigint>::max()) + negative;
+    if (mantissa > limit) {
+      return left(json_parse_error::number_out_of_range);
+    }
+    return right(json_number { true, negative ? static_cast<bigint>(0 - mantissa) : static_cast<bigint>(mantissa), 0 });
+  }
+
+  auto decimal_exponent = exponent - static_cast<std::int64_t>(fraction_digits);
+  if (integer_digits + fraction_digits <= ZEN_JSON_MAX_MANTISSA_DIGITS
+      && mantissa <= ZEN_JSON_MAX_EXACT_MANTISSA
+      && decimal_exponent >= -22
+      && decimal_exponent <= 22) {
+    auto f = static_cast<fractional>(mantissa);
+    if (decimal_exponent < 0) {
+      f /= exact_powers_of_ten[-decimal_exponent];
+    } else {
+      f *= exact_powers_of_ten[decimal_exponent];
+    }
+    return right(json_number { false, 0, negative ? -f : f });
+  }
+
+  fractional f;
+  auto [_, error] = std::from_chars(start, ptr, f);
+  if (error == std::errc::result_out_of_range) {
+    // Tell overflow apart from underflow by the position of the first
+    // significant digit.
+    std::int64_t magnitude = exponent;
+    if (mantissa != 0 && *integer_start != '0') {
+      magnitude += integer_digits;
+    }
+    if (magnitude > 0) {
+      return left(json_parse_error::number_out_of_range);
+    }
+    f = negative ? -0.0 : 0.0;
+  }
+  return right(json_number { false, 0, f });
+}
+
 json_parse_result parse_json(std::istream& in) {
 
   value result;
   std::optional<string> key;
   std::stack<value> building;
+  string number_chars;
 
   for (;;) {
 
@@ -377,14 +961,15 @@ json_parse_result parse_json(std::istream& in) {
       in.get(); \
     }
 
-#define ZEN_SCAN_DIGIT(name) \
-  unsigned char name; \
+#define ZEN_SCAN_HEX4(name) \
+  char32_t name; \
   { \
-    auto ch = in.get(); \
-    if (!is_json_digit(ch)) { \
-      return zen::left(json_parse_error::unexpected_character); \
+    char digits[4]; \
+    if (!in.read(digits, 4)) { \
+      return left(json_parse_error::unexpected_end_of_input); \
     } \
-    name = parse_decimal_digit(ch); \
+    const char* ptr = digits; \
+    ZEN_TRY_DISCARD(scan_json_hex4(ptr, digits + 4, name)); \
   }
 
 #define ZEN_ASSERT_CHAR(ch, expected) \
@@ -416,6 +1001,7 @@ json_parse_result parse_json(std::istream& in) {
         building.push(array {});
         continue;
 
+      case '-':
       case '0':
       case '1':
       case '2':
@@ -427,141 +1013,39 @@ json_parse_result parse_json(std::istream& in) {
       case '8':
       case '9':
       {
-        bigint x = parse_decimal_digit(c0);
-
+        number_chars.assign(1, static_cast<char>(c0));
         for (;;) {
-
-          c0 = in.peek();
-
-          switch (c0) {
-
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-              in.get();
-              x = x * 10 + parse_decimal_digit(c0);
-              continue;
-
-            case '.':
-            {
-              in.get();
-              fractional e = 1.0;
-              fractional y = 0.0;
-              fractional k = 1.0;
-
-              for (;;) {
-
-                auto c1 = in.peek();
-
-                switch (c1) {
-
-                  case '0':
-                  case '1':
-                  case '2':
-                  case '3':
-                  case '4':
-                  case '5':
-                  case '6':
-                  case '7':
-                  case '8':
-                  case '9':
-                    in.get();
-                    k /= 10.0;
-                    y += k * parse_decimal_digit(c1);
-                    continue;
-
-                  case 'e':
-                  case 'E':
-                  {
-                    in.get();
-                    e = 0.0;
-                    for (;;) {
-                      auto c2 = in.peek();
-                      switch (c2) {
-                        case '+':
-                          in.get();
-                          break;
-                        case '-':
-                          in.get();
-                          e *= -1;
-                          break;
-                        case '0':
-                        case '1':
-                        case '2':
-                        case '3':
-                        case '4':
-                        case '5':
-                        case '6':
-                        case '7':
-                        case '8':
-                        case '9':
-                          in.get();
-                          e = e * 10.0 + parse_decimal_digit(c2);
-                          break;
-                        case EOF:
-                        case ']':
-                        case '}':
-                        case ',':
-                        case ' ':
-                        case '\t':
-                        case '\r':
-                        case '\n':
-                          goto finish_fractional;
-                        default:
-                          return left(json_parse_error::unexpected_character);
-                      }
-                    }
-                  }
-
-                  case EOF:
-                  case ']':
-                  case '}':
-                  case ',':
-                  case ' ':
-                  case '\t':
-                  case '\r':
-                  case '\n':
-                    goto finish_fractional;
-
-                  default:
-                    return left(json_parse_error::unexpected_character);
-
-                }
-
-              }
-
-finish_fractional:
-              result = value(std::pow(x + y, e));
-              goto process_result;
-
-            }
-
-            case ']':
-            case '}':
-            case ',':
-            case ' ':
-            case '\t':
-            case '\r':
-            case '\n':
-            case EOF:
-              goto finish_integer;
-
-            default:
-              return left(json_parse_error::unexpected_character);
-
+          auto c1 = in.peek();
+          if (!is_json_digit(c1) && c1 != '.' && c1 != 'e' && c1 != 'E' && c1 != '+' && c1 != '-') {
+            break;
           }
-
+          number_chars.push_back(static_cast<char>(in.get()));
+        }
+        switch (in.peek()) {
+          case EOF:
+          case ']':
+          case '}':
+          case ',':
+          case ' ':
+          case '\t':
+          case '\r':
+          case '\n':
+            break;
+          default:
+            return left(json_parse_error::unexpected_character);
+        }
+        const char* ptr = number_chars.data();
+        const char* end = ptr + number_chars.size();
+        auto number = scan_json_number(ptr, end);
+        ZEN_TRY(number);
+        if (ptr != end) {
+          return left(json_parse_error::unexpected_character);
+        }
+        if (number->is_integer) {
+          result = value(number->integer);
+        } else {
+          result = value(number->fraction);
         }
-
-finish_integer:
-        result = value(x);
         break;
       }
 
@@ -604,12 +1088,22 @@ finish_integer:
                   chars.push_back('\t');
                   break;
                 case 'u':
-                  ZEN_SCAN_DIGIT(d0);
-                  ZEN_SCAN_DIGIT(d1);
-                  ZEN_SCAN_DIGIT(d2);
-                  ZEN_SCAN_DIGIT(d3);
-                  chars.push_back(d0 * 1000 + d1 * 100 + d2 * 10 + d3);
+                {
+                  ZEN_SCAN_HEX4(code_point);
+                  if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    ZEN_EXPECT_CHAR('\\');
+                    ZEN_EXPECT_CHAR('u');
+                    ZEN_SCAN_HEX4(low);
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                      return left(json_parse_error::unrecognised_escape_sequence);
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                  } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    return left(json_parse_error::unrecognised_escape_sequence);
+                  }
+                  append_utf8(chars, code_point);
                   break;
+                }
                 default:
                   return left(json_parse_error::unrecognised_escape_sequence);
               }
@@ -706,8 +1200,1319 @@ process_result:
 }
 
 json_parse_result parse_json(const std::string& in) {
-  std::istringstream iss(in);
-  return parse_json(iss);
+  return parse_json(in.data(), in.size());
+}
+
+static bool scan_json_literal(const char*& ptr, const char* end, const char* literal, std::size_t size) {
+  if (static_cast<std::size_t>(end - ptr) < size || std::memcmp(ptr, literal, size) != 0) {
+    return false;
+  }
+  ptr += size;
+  return true;
+}
+
+/// Hands out the tokens of a JSON text by walking over its structural index.
+class json_index_cursor {
+
+  const char* data;
+  json_structural_index::const_iterator curr;
+  json_structural_index::const_iterator last;
+
+public:
+
+  json_index_cursor(const char* data, const json_structural_index& index):
+    data(data), curr(index.cbegin()), last(index.cend()) {}
+
+  bool next(const char*& ptr) {
+    if (curr == last) {
+      return false;
+    }
+    ptr = data + *curr++;
+    return true;
+  }
+
+  bool next_is(char ch) {
+    if (curr != last && data[*curr] == ch) {
+      ++curr;
+      return true;
+    }
+    return false;
+  }
+
+  void skip_to(const char*) {}
+
+  bool at_end() const {
+    return curr == last;
+  }
+
+};
+
+/// Hands out the tokens of a JSON text by skipping over whitespace, directly
+/// on the contiguous input.
+class json_scan_cursor {
+
+  const char* ptr;
+  const char* end;
+
+  void skip_whitespace() {
+    while (ptr != end && is_json_whitespace(*ptr)) {
+      ++ptr;
+    }
+  }
+
+public:
+
+  json_scan_cursor(const char* data, std::size_t size):
+    ptr(data), end(data + size) {}
+
+  bool next(const char*& out) {
+    skip_whitespace();
+    if (ptr == end) {
+      return false;
+    }
+    out = ptr++;
+    return true;
+  }
+
+  bool next_is(char ch) {
+    skip_whitespace();
+    if (ptr != end && *ptr == ch) {
+      ++ptr;
+      return true;
+    }
+    return false;
+  }
+
+  void skip_to(const char* new_ptr) {
+    ptr = new_ptr;
+  }
+
+  bool at_end() {
+    skip_whitespace();
+    return ptr == end;
+  }
+
+};
+
+/// Builds a @ref basic_value out of the tokens reported by
+/// @ref walk_json_tokens.
+///
+/// Arrays, objects and strings are allocated using the allocator that was
+/// passed in during construction.
+template<typename ValueT>
+class json_value_builder {
+
+  using allocator_type = typename ValueT::allocator_type;
+  using string_type = typename ValueT::string_type;
+  using array = typename ValueT::array;
+  using object = typename ValueT::object;
+
+  allocator_type allocator;
+  std::vector<ValueT> building;
+  std::vector<string_type> keys;
+
+  void add(ValueT&& element) {
+    if (building.empty()) {
+      result = std::move(element);
+    } else if (building.back().is_array()) {
+      building.back().as_array().push_back(std::move(element));
+    } else {
+      building.back().as_object().emplace(std::move(keys.back()), std::move(element));
+      keys.pop_back();
+    }
+  }
+
+  void end_container() {
+    auto element = std::move(building.back());
+    building.pop_back();
+    add(std::move(element));
+  }
+
+public:
+
+  ValueT result;
+
+  json_value_builder(const allocator_type& allocator = allocator_type()):
+    allocator(allocator) {}
+
+  std::size_t depth() const {
+    return building.size();
+  }
+
+  bool in_object() const {
+    return building.back().is_object();
+  }
+
+  void start_object() {
+    building.push_back(ValueT(object(allocator)));
+  }
+
+  void end_object() {
+    end_container();
+  }
+
+  void start_array() {
+    building.push_back(ValueT(array(allocator)));
+  }
+
+  void end_array() {
+    end_container();
+  }
+
+  either<json_parse_error, void> add_key(const char*& ptr, const char* end) {
+    keys.emplace_back(allocator);
+    return scan_json_string(ptr, end, keys.back());
+  }
+
+  either<json_parse_error, void> add_string(const char*& ptr, const char* end) {
+    string_type chars(allocator);
+    ZEN_TRY_DISCARD(scan_json_string(ptr, end, chars));
+    add(ValueT(std::move(chars)));
+    return right();
+  }
+
+  void add_integer(bigint x) {
+    add(ValueT(x));
+  }
+
+  void add_fractional(fractional x) {
+    add(ValueT(x));
+  }
+
+  void add_boolean(bool x) {
+    add(ValueT(x));
+  }
+
+  void add_null() {
+    add(ValueT(null {}));
+  }
+
+};
+
+/// Walk over the tokens handed out by the given cursor, checking the JSON
+/// grammar and reporting the values that were found to the builder.
+///
+/// Single-character tokens are consumed by the cursor itself. After scanning a
+/// longer token, the cursor is told where that token ended. Strings are
+/// decoded by the builder, so that it can choose where they end up.
+template<typename CursorT, typename BuilderT>
+static either<json_parse_error, void> walk_json_tokens(CursorT& cursor, const char* end, BuilderT& builder) {
+
+  const char* ptr;
+
+#define ZEN_NEXT_TOKEN \
+  if (!cursor.next(ptr)) { \
+    return left(json_parse_error::unexpected_end_of_input); \
+  }
+
+#define ZEN_EXPECT_BOUNDARY \
+  if (!is_json_boundary(ptr, end)) { \
+    return left(json_parse_error::unexpected_character); \
+  } \
+  cursor.skip_to(ptr);
+
+parse_value:
+
+  ZEN_NEXT_TOKEN
+
+  switch (*ptr) {
+
+    case '{':
+      builder.start_object();
+      if (cursor.next_is('}')) {
+        builder.end_object();
+        goto finish_value;
+      }
+      goto parse_key;
+
+    case '[':
+      builder.start_array();
+      if (cursor.next_is(']')) {
+        builder.end_array();
+        goto finish_value;
+      }
+      goto parse_value;
+
+    case '"':
+      ++ptr;
+      ZEN_TRY_DISCARD(builder.add_string(ptr, end));
+      cursor.skip_to(ptr);
+      goto finish_value;
+
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    {
+      auto number = scan_json_number(ptr, end);
+      ZEN_TRY(number);
+      ZEN_EXPECT_BOUNDARY
+      if (number->is_integer) {
+        builder.add_integer(number->integer);
+      } else {
+        builder.add_fractional(number->fraction);
+      }
+      goto finish_value;
+    }
+
+    case 't':
+      if (!scan_json_literal(ptr, end, "true", 4)) {
+        return left(json_parse_error::unexpected_character);
+      }
+      ZEN_EXPECT_BOUNDARY
+      builder.add_boolean(true);
+      goto finish_value;
+
+    case 'f':
+      if (!scan_json_literal(ptr, end, "false", 5)) {
+        return left(json_parse_error::unexpected_character);
+      }
+      ZEN_EXPECT_BOUNDARY
+      builder.add_boolean(false);
+      goto finish_value;
+
+    case 'n':
+      if (!scan_json_literal(ptr, end, "null", 4)) {
+        return left(json_parse_error::unexpected_character);
+      }
+      ZEN_EXPECT_BOUNDARY
+      builder.add_null();
+      goto finish_value;
+
+    default:
+      return left(json_parse_error::unexpected_character);
+
+  }
+
+parse_key:
+
+  ZEN_NEXT_TOKEN
+
+  if (*ptr != '"') {
+    return left(json_parse_error::unexpected_character);
+  }
+  ++ptr;
+  ZEN_TRY_DISCARD(builder.add_key(ptr, end));
+  cursor.skip_to(ptr);
+
+  ZEN_NEXT_TOKEN
+
+  if (*ptr != ':') {
+    return left(json_parse_error::unexpected_character);
+  }
+  goto parse_value;
+
+finish_value:
+
+  if (builder.depth() == 0) {
+    if (!cursor.at_end()) {
+      return left(json_parse_error::unexpected_character);
+    }
+    return right();
+  }
+
+  ZEN_NEXT_TOKEN
+
+  switch (*ptr) {
+    case ',':
+      if (builder.in_object()) {
+        goto parse_key;
+      }
+      goto parse_value;
+    case ']':
+      if (builder.in_object()) {
+        return left(json_parse_error::unexpected_character);
+      }
+      builder.end_array();
+      goto finish_value;
+    case '}':
+      if (!builder.in_object()) {
+        return left(json_parse_error::unexpected_character);
+      }
+      builder.end_object();
+      goto finish_value;
+    default:
+      return left(json_parse_error::unexpected_character);
+  }
+
+#undef ZEN_NEXT_TOKEN
+#undef ZEN_EXPECT_BOUNDARY
+
+}
+
+template<typename ValueT = value, typename CursorT>
+static either<json_parse_error, ValueT> parse_json_tokens(
+  CursorT& cursor,
+  const char* end,
+  const typename ValueT::allocator_type& allocator = {}
+) {
+  json_value_builder<ValueT> builder { allocator };
+  ZEN_TRY_DISCARD(walk_json_tokens(cursor, end, builder));
+  return right(std::move(builder.result));
+}
+
+json_parse_result parse_json(const char* data, std::size_t size) {
+  json_scan_cursor cursor { data, size };
+  return parse_json_tokens(cursor, data + size);
+}
+
+json_parse_result parse_json(std::string_view in) {
+  return parse_json(in.data(), in.size());
+}
+
+json_parse_result parse_json(const bytestring& in) {
+  return parse_json(in.data(), in.size());
+}
+
+json_parse_result parse_json(const char* in) {
+  return parse_json(in, std::strlen(in));
+}
+
+json_pool_parse_result parse_json(const char* data, std::size_t size, allocator_ref pool) {
+  json_scan_cursor cursor { data, size };
+  return parse_json_tokens<pool_value>(cursor, data + size, pool);
+}
+
+json_pool_parse_result parse_json(std::string_view in, allocator_ref pool) {
+  return parse_json(in.data(), in.size(), pool);
+}
+
+/// Forwards the tokens reported by @ref walk_json_tokens to a
+/// @ref json_handler.
+class json_handler_builder {
+
+  json_handler& handler;
+
+  /// For every array or object that is open, whether it is an object.
+  std::vector<bool> containers;
+
+  /// Holds strings that contain escape sequences while they are reported.
+  string scratch;
+
+  /// Scan a string, pointing into the input when it needs no decoding.
+  either<json_parse_error, std::string_view> scan_string(const char*& ptr, const char* end) {
+    auto start = ptr;
+    while (ptr != end && *ptr != '"' && *ptr != '\\' && static_cast<unsigned char>(*ptr) >= 0x20) {
+      ++ptr;
+    }
+    if (ptr != end && *ptr == '"') {
+      ++ptr;
+      return right(std::string_view { start, static_cast<std::size_t>(ptr - 1 - start) });
+    }
+    scratch.assign(start, ptr);
+    ZEN_TRY_DISCARD(scan_json_string(ptr, end, scratch));
+    return right(std::string_view { scratch });
+  }
+
+public:
+
+  json_handler_builder(json_handler& handler):
+    handler(handler) {}
+
+  std::size_t depth() const {
+    return containers.size();
+  }
+
+  bool in_object() const {
+    return containers.back();
+  }
+
+  void start_object() {
+    containers.push_back(true);
+    handler.on_object_start();
+  }
+
+  void end_object() {
+    containers.pop_back();
+    handler.on_object_end();
+  }
+
+  void start_array() {
+    containers.push_back(false);
+    handler.on_array_start();
+  }
+
+  void end_array() {
+    containers.pop_back();
+    handler.on_array_end();
+  }
+
+  either<json_parse_error, void> add_key(const char*& ptr, const char* end) {
+    auto key = scan_string(ptr, end);
+    ZEN_TRY(key);
+    handler.on_key(*key);
+    return right();
+  }
+
+  either<json_parse_error, void> add_string(const char*& ptr, const char* end) {
+    auto str = scan_string(ptr, end);
+    ZEN_TRY(str);
+    handler.on_string(*str);
+    return right();
+  }
+
+  void add_integer(bigint x) {
+    handler.on_integer(x);
+  }
+
+  void add_fractional(fractional x) {
+    handler.on_fractional(x);
+  }
+
+  void add_boolean(bool x) {
+    handler.on_boolean(x);
+  }
+
+  void add_null() {
+    handler.on_null();
+  }
+
+};
+
+either<json_parse_error, void> parse_json(const char* data, std::size_t size, json_handler& handler) {
+  json_scan_cursor cursor { data, size };
+  json_handler_builder builder { handler };
+  return walk_json_tokens(cursor, data + size, builder);
+}
+
+either<json_parse_error, void> parse_json(std::string_view in, json_handler& handler) {
+  return parse_json(in.data(), in.size(), handler);
+}
+
+json_parse_result parse_json_indexed(const char* data, std::size_t size) {
+
+  if (size > std::numeric_limits<std::uint32_t>::max()) {
+    return left(json_parse_error::input_too_large);
+  }
+
+  // The index is still usable when the text ends inside a string, so that
+  // an error before that string is reported just like parse_json would.
+  json_structural_index index;
+  auto complete = index_json(data, size, index);
+
+  json_index_cursor cursor { data, index };
+  auto result = parse_json_tokens(cursor, data + size);
+  if (!complete && result.is_right()) {
+    return left(json_parse_error::unexpected_end_of_input);
+  }
+  return result;
+}
+
+json_parse_result parse_json_indexed(const std::string& in) {
+  return parse_json_indexed(in.data(), in.size());
+}
+
+/// Find the end of a string that may be split over several chunks.
+///
+/// Returns a pointer right after the closing quote, or `nullptr` if the chunk
+/// ended first. @p escaped carries over whether the next character is
+/// escaped.
+static const char* find_json_string_end(const char* ptr, const char* end, bool& escaped) {
+  for (; ptr != end; ++ptr) {
+    if (escaped) {
+      escaped = false;
+    } else if (*ptr == '\\') {
+      escaped = true;
+    } else if (*ptr == '"') {
+      return ptr + 1;
+    }
+  }
+  return nullptr;
+}
+
+void json_push_parser::add(value&& element) {
+  if (building.empty()) {
+    result.emplace(std::move(element));
+    curr = state::done;
+    return;
+  }
+  if (building.back().is_array()) {
+    building.back().as_array().push_back(std::move(element));
+  } else {
+    building.back().as_object().emplace(std::move(keys.back()), std::move(element));
+    keys.pop_back();
+  }
+  curr = state::comma_or_end;
+}
+
+void json_push_parser::end_container() {
+  auto element = std::move(building.back());
+  building.pop_back();
+  add(std::move(element));
+}
+
+either<json_parse_error, void> json_push_parser::add_string(const char* ptr, const char* end) {
+  string chars;
+  ZEN_TRY_DISCARD(scan_json_string(ptr, end, chars));
+  if (token_is_key) {
+    keys.push_back(std::move(chars));
+    curr = state::colon;
+  } else {
+    add(value(std::move(chars)));
+  }
+  return right();
+}
+
+either<json_parse_error, void> json_push_parser::add_scalar(const char* ptr, const char* end) {
+  auto size = static_cast<std::size_t>(end - ptr);
+  switch (*ptr) {
+    case 't':
+      if (size != 4 || std::memcmp(ptr, "true", 4) != 0) {
+        return left(json_parse_error::unexpected_character);
+      }
+      add(value(true));
+      return right();
+    case 'f':
+      if (size != 5 || std::memcmp(ptr, "false", 5) != 0) {
+        return left(json_parse_error::unexpected_character);
+      }
+      add(value(false));
+      return right();
+    case 'n':
+      if (size != 4 || std::memcmp(ptr, "null", 4) != 0) {
+        return left(json_parse_error::unexpected_character);
+      }
+      add(value(null {}));
+      return right();
+    default:
+    {
+      auto number = scan_json_number(ptr, end);
+      ZEN_TRY(number);
+      if (ptr != end) {
+        return left(json_parse_error::unexpected_character);
+      }
+      if (number->is_integer) {
+        add(value(number->integer));
+      } else {
+        add(value(number->fraction));
+      }
+      return right();
+    }
+  }
+}
+
+either<json_parse_error, void> json_push_parser::feed_impl(const char* ptr, const char* end) {
+
+  // Finish the token that was cut off at the end of the previous chunk
+  if (curr == state::string) {
+    auto close = find_json_string_end(ptr, end, pending_escaped);
+    if (close == nullptr) {
+      pending.append(ptr, end);
+      return right();
+    }
+    pending.append(ptr, close);
+    ptr = close;
+    ZEN_TRY_DISCARD(add_string(pending.data(), pending.data() + pending.size()));
+    pending.clear();
+  } else if (curr == state::scalar) {
+    auto token_end = ptr;
+    while (!is_json_boundary(token_end, end)) {
+      ++token_end;
+    }
+    pending.append(ptr, token_end);
+    if (token_end == end) {
+      return right();
+    }
+    ptr = token_end;
+    ZEN_TRY_DISCARD(add_scalar(pending.data(), pending.data() + pending.size()));
+    pending.clear();
+  }
+
+  while (ptr != end) {
+
+    auto ch = *ptr;
+
+    if (is_json_whitespace(ch)) {
+      ++ptr;
+      continue;
+    }
+
+    bool start_string = false;
+
+    switch (curr) {
+
+      case state::done:
+        return left(json_parse_error::unexpected_character);
+
+      case state::colon:
+        if (ch != ':') {
+          return left(json_parse_error::unexpected_character);
+        }
+        ++ptr;
+        curr = state::value;
+        continue;
+
+      case state::comma_or_end:
+        if (ch == ',') {
+          ++ptr;
+          curr = building.back().is_object() ? state::key : state::value;
+          continue;
+        }
+        if (ch != (building.back().is_object() ? '}' : ']')) {
+          return left(json_parse_error::unexpected_character);
+        }
+        ++ptr;
+        end_container();
+        continue;
+
+      case state::key_or_object_end:
+        if (ch == '}') {
+          ++ptr;
+          end_container();
+          continue;
+        }
+        [[fallthrough]];
+
+      case state::key:
+        if (ch != '"') {
+          return left(json_parse_error::unexpected_character);
+        }
+        token_is_key = true;
+        start_string = true;
+        break;
+
+      case state::value_or_array_end:
+        if (ch == ']') {
+          ++ptr;
+          end_container();
+          continue;
+        }
+        [[fallthrough]];
+
+      case state::value:
+        switch (ch) {
+          case '{':
+            ++ptr;
+            building.push_back(value(object {}));
+            curr = state::key_or_object_end;
+            continue;
+          case '[':
+            ++ptr;
+            building.push_back(value(array {}));
+            curr = state::value_or_array_end;
+            continue;
+          case '"':
+            token_is_key = false;
+            start_string = true;
+            break;
+          case '-':
+          case '0':
+          case '1':
+          case '2':
+          case '3':
+          case '4':
+          case '5':
+          case '6':
+          case '7':
+          case '8':
+          case '9':
+          case 't':
+          case 'f':
+          case 'n':
+            break;
+          default:
+            return left(json_parse_error::unexpected_character);
+        }
+        break;
+
+      case state::string:
+      case state::scalar:
+        ZEN_UNREACHABLE
+
+    }
+
+    if (start_string) {
+      ++ptr;
+      bool escaped = false;
+      auto close = find_json_string_end(ptr, end, escaped);
+      if (close == nullptr) {
+        pending.assign(ptr, end);
+        pending_escaped = escaped;
+        curr = state::string;
+        return right();
+      }
+      ZEN_TRY_DISCARD(add_string(ptr, close));
+      ptr = close;
+    } else {
+      auto token_end = ptr;
+      while (!is_json_boundary(token_end, end)) {
+        ++token_end;
+      }
+      if (token_end == end) {
+        pending.assign(ptr, end);
+        curr = state::scalar;
+        return right();
+      }
+      ZEN_TRY_DISCARD(add_scalar(ptr, token_end));
+      ptr = token_end;
+    }
+
+  }
+
+  return right();
+}
+
+either<json_parse_error, void> json_push_parser::feed(const char* data, std::size_t size) {
+  if (error) {
+    return left(*error);
+  }
+  auto status = feed_impl(data, data + size);
+  if (status.is_left()) {
+    error = status.left();
+    return left(*error);
+  }
+  return right();
+}
+
+json_parse_result json_push_parser::finish() {
+  if (!error && curr == state::scalar) {
+    auto status = add_scalar(pending.data(), pending.data() + pending.size());
+    if (status.is_left()) {
+      error = status.left();
+    }
+  }
+  if (!error && curr != state::done) {
+    error = json_parse_error::unexpected_end_of_input;
+  }
+  json_parse_result out = error
+    ? json_parse_result(left(*error))
+    : json_parse_result(right(std::move(*result)));
+  curr = state::value;
+  building.clear();
+  keys.clear();
+  result.reset();
+  pending.clear();
+  pending_escaped = false;
+  error.reset();
+  return out;
+}
+
+/// Writes decoded string contents directly into the string buffer of a
+/// @ref json_document.
+struct json_raw_sink {
+
+  char* ptr;
+
+  void append(const char* first, const char* last) {
+    std::memcpy(ptr, first, last - first);
+    ptr += last - first;
+  }
+
+  void push_back(char ch) {
+    *ptr++ = ch;
+  }
+
+};
+
+/// Builds the tape of a @ref json_document out of the tokens reported by
+/// @ref walk_json_tokens.
+///
+/// While a container is still open, its start word holds the index of the
+/// container that encloses it and the amount of children that were added so
+/// far. This way, no separate stack is needed.
+class json_tape_builder {
+
+  std::uint64_t* tape;
+  std::size_t tape_size = 0;
+  std::size_t tape_capacity;
+  std::size_t open = 0;
+  std::size_t nesting = 0;
+
+  char* strings;
+  json_raw_sink sink;
+
+  static std::uint64_t make_word(char tag, std::uint64_t payload) {
+    return (static_cast<std::uint64_t>(static_cast<unsigned char>(tag)) << 56) | payload;
+  }
+
+  void push(std::uint64_t word) {
+    ZEN_DEBUG_ASSERT(tape_size < tape_capacity);
+    tape[tape_size++] = word;
+  }
+
+  void count_child() {
+    if (nesting > 0 && ((tape[open] >> 32) & ZEN_JSON_TAPE_COUNT_MASK) < ZEN_JSON_TAPE_COUNT_MASK) {
+      tape[open] += std::uint64_t(1) << 32;
+    }
+  }
+
+  void start_container(char tag) {
+    push(make_word(tag, open));
+    open = tape_size - 1;
+    ++nesting;
+  }
+
+  void end_container(char tag) {
+    auto start = open;
+    auto word = tape[start];
+    open = word & 0xFFFFFFFF;
+    --nesting;
+    push(make_word(tag, start));
+    tape[start] = (word & ~std::uint64_t(0xFFFFFFFF)) | tape_size;
+    count_child();
+  }
+
+  either<json_parse_error, void> push_string(const char*& ptr, const char* end) {
+    auto start = sink.ptr;
+    ZEN_TRY_DISCARD(scan_json_string(ptr, end, sink));
+    push(make_word('"', start - strings));
+    push(sink.ptr - start);
+    return right();
+  }
+
+public:
+
+  json_tape_builder(std::uint64_t* tape, std::size_t tape_capacity, char* strings):
+    tape(tape), tape_capacity(tape_capacity), strings(strings), sink { strings } {}
+
+  std::size_t depth() const {
+    return nesting;
+  }
+
+  bool in_object() const {
+    return static_cast<char>(tape[open] >> 56) == '{';
+  }
+
+  void start_object() {
+    start_container('{');
+  }
+
+  void end_object() {
+    end_container('}');
+  }
+
+  void start_array() {
+    start_container('[');
+  }
+
+  void end_array() {
+    end_container(']');
+  }
+
+  either<json_parse_error, void> add_key(const char*& ptr, const char* end) {
+    return push_string(ptr, end);
+  }
+
+  either<json_parse_error, void> add_string(const char*& ptr, const char* end) {
+    ZEN_TRY_DISCARD(push_string(ptr, end));
+    count_child();
+    return right();
+  }
+
+  void add_integer(bigint x) {
+    push(make_word('l', 0));
+    push(static_cast<std::uint64_t>(x));
+    count_child();
+  }
+
+  void add_fractional(fractional x) {
+    push(make_word('d', 0));
+    push(std::bit_cast<std::uint64_t>(x));
+    count_child();
+  }
+
+  void add_boolean(bool x) {
+    push(make_word(x ? 't' : 'f', 0));
+    count_child();
+  }
+
+  void add_null() {
+    push(make_word('n', 0));
+    count_child();
+  }
+
+};
+
+json_document_result parse_json_document(const char* data, std::size_t size) {
+
+  if (size > std::numeric_limits<std::uint32_t>::max()) {
+    return left(json_parse_error::input_too_large);
+  }
+
+  // Every value takes at least as many bytes in the input as it takes words
+  // on the tape, except for numbers, which take two words. Because every
+  // number but the last one is followed by a separator that takes no words,
+  // one extra word is sufficient. Decoding a string never makes it longer.
+  auto tape_capacity = size + 1;
+  std::unique_ptr<std::uint64_t[]> tape { new std::uint64_t[tape_capacity] };
+  std::unique_ptr<char[]> strings { new char[size] };
+
+  json_scan_cursor cursor { data, size };
+  json_tape_builder builder { tape.get(), tape_capacity, strings.get() };
+  ZEN_TRY_DISCARD(walk_json_tokens(cursor, data + size, builder));
+
+  return right(json_document { std::move(tape), std::move(strings) });
+}
+
+json_document_result parse_json_document(std::string_view in) {
+  return parse_json_document(in.data(), in.size());
+}
+
+value json_view::to_value() const {
+  switch (get_type()) {
+    case value_type::object:
+    {
+      object result;
+      for (auto [key, field]: fields()) {
+        result.emplace(string(key), field.to_value());
+      }
+      return value(std::move(result));
+    }
+    case value_type::array:
+    {
+      array result;
+      result.reserve(size());
+      for (auto element: elements()) {
+        result.push_back(element.to_value());
+      }
+      return value(std::move(result));
+    }
+    case value_type::string:
+      return value(string(as_string()));
+    case value_type::integer:
+      return value(as_integer());
+    case value_type::fractional:
+      return value(as_fractional());
+    case value_type::boolean:
+      return value(as_boolean());
+    case value_type::null:
+      return value(null {});
+  }
+  ZEN_UNREACHABLE
+}
+
+static const char* skip_json_whitespace(const char* ptr, const char* end) {
+  while (ptr != end && is_json_whitespace(*ptr)) {
+    ++ptr;
+  }
+  return ptr;
+}
+
+/// Find the end of a string, starting right after the opening quote.
+///
+/// Returns a pointer right after the closing quote, or `nullptr` if the string
+/// is not terminated. Escape sequences are not validated.
+static const char* skip_json_string(const char* ptr, const char* end) {
+  auto start = ptr;
+  for (;;) {
+    auto quote = static_cast<const char*>(std::memchr(ptr, '"', end - ptr));
+    if (quote == nullptr) {
+      return nullptr;
+    }
+    auto backslash = quote;
+    while (backslash != start && backslash[-1] == '\\') {
+      --backslash;
+    }
+    if ((quote - backslash) % 2 == 0) {
+      return quote + 1;
+    }
+    ptr = quote + 1;
+  }
+}
+
+/// Find the end of an array or object by counting brackets.
+///
+/// Only strings are looked into, so that brackets inside of them are not
+/// counted. Everything else is left unchecked.
+static const char* skip_json_container(const char* ptr, const char* end) {
+  std::size_t depth = 0;
+  while (ptr != end) {
+    switch (*ptr++) {
+      case '"':
+        ptr = skip_json_string(ptr, end);
+        if (ptr == nullptr) {
+          return nullptr;
+        }
+        break;
+      case '{':
+      case '[':
+        ++depth;
+        break;
+      case '}':
+      case ']':
+        if (--depth == 0) {
+          return ptr;
+        }
+        break;
+    }
+  }
+  return nullptr;
+}
+
+static const char* skip_json_scalar(const char* ptr, const char* end) {
+  while (!is_json_boundary(ptr, end)) {
+    ++ptr;
+  }
+  return ptr;
+}
+
+either<json_parse_error, const char*> json_ondemand_value::skip() const {
+  if (has_error()) {
+    return left(error);
+  }
+  const char* after;
+  switch (*ptr) {
+    case '{':
+    case '[':
+      after = skip_json_container(ptr, end);
+      break;
+    case '"':
+      after = skip_json_string(ptr + 1, end);
+      break;
+    default:
+      after = skip_json_scalar(ptr, end);
+      if (after == ptr) {
+        return left(json_parse_error::unexpected_character);
+      }
+      break;
+  }
+  if (after == nullptr) {
+    return left(json_parse_error::unexpected_end_of_input);
+  }
+  return right(after);
+}
+
+either<json_parse_error, value_type> json_ondemand_value::get_type() const {
+  if (has_error()) {
+    return left(error);
+  }
+  switch (*ptr) {
+    case '{':
+      return right(value_type::object);
+    case '[':
+      return right(value_type::array);
+    case '"':
+      return right(value_type::string);
+    case 't':
+    case 'f':
+      return right(value_type::boolean);
+    case 'n':
+      return right(value_type::null);
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    {
+      auto p = ptr;
+      auto number = scan_json_number(p, end);
+      ZEN_TRY(number);
+      return right(number->is_integer ? value_type::integer : value_type::fractional);
+    }
+    default:
+      return left(json_parse_error::unexpected_character);
+  }
+}
+
+json_ondemand_value json_ondemand_value::operator[](std::string_view key) const {
+  if (has_error()) {
+    return *this;
+  }
+  if (*ptr != '{') {
+    return json_parse_error::incorrect_type;
+  }
+  auto p = skip_json_whitespace(ptr + 1, end);
+  if (p != end && *p == '}') {
+    return json_parse_error::no_such_field;
+  }
+  for (;;) {
+    if (p == end) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    if (*p != '"') {
+      return json_parse_error::unexpected_character;
+    }
+    auto key_start = p + 1;
+    auto key_end = skip_json_string(key_start, end);
+    if (key_end == nullptr) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    std::string_view raw_key { key_start, static_cast<std::size_t>(key_end - 1 - key_start) };
+    bool matches;
+    if (raw_key.find('\\') == std::string_view::npos) {
+      matches = raw_key == key;
+    } else {
+      string decoded;
+      auto q = key_start;
+      auto result = scan_json_string(q, end, decoded);
+      if (result.is_left()) {
+        return result.left();
+      }
+      matches = decoded == key;
+    }
+    p = skip_json_whitespace(key_end, end);
+    if (p == end) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    if (*p != ':') {
+      return json_parse_error::unexpected_character;
+    }
+    p = skip_json_whitespace(p + 1, end);
+    if (p == end) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    json_ondemand_value field { p, end };
+    if (matches) {
+      return field;
+    }
+    auto after = field.skip();
+    if (after.is_left()) {
+      return after.left();
+    }
+    p = skip_json_whitespace(*after, end);
+    if (p == end) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    if (*p == '}') {
+      return json_parse_error::no_such_field;
+    }
+    if (*p != ',') {
+      return json_parse_error::unexpected_character;
+    }
+    p = skip_json_whitespace(p + 1, end);
+  }
+}
+
+json_ondemand_value json_ondemand_value::operator[](std::size_t position) const {
+  if (has_error()) {
+    return *this;
+  }
+  if (*ptr != '[') {
+    return json_parse_error::incorrect_type;
+  }
+  auto p = skip_json_whitespace(ptr + 1, end);
+  if (p != end && *p == ']') {
+    return json_parse_error::index_out_of_range;
+  }
+  for (std::size_t i = 0;; ++i) {
+    if (p == end) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    json_ondemand_value element { p, end };
+    if (i == position) {
+      return element;
+    }
+    auto after = element.skip();
+    if (after.is_left()) {
+      return after.left();
+    }
+    p = skip_json_whitespace(*after, end);
+    if (p == end) {
+      return json_parse_error::unexpected_end_of_input;
+    }
+    if (*p == ']') {
+      return json_parse_error::index_out_of_range;
+    }
+    if (*p != ',') {
+      return json_parse_error::unexpected_character;
+    }
+    p = skip_json_whitespace(p + 1, end);
+  }
+}
+
+either<json_parse_error, std::string_view> json_ondemand_value::get_raw_json() const {
+  auto after = skip();
+  ZEN_TRY(after);
+  return right(std::string_view { ptr, static_cast<std::size_t>(*after - ptr) });
+}
+
+either<json_parse_error, bool> json_ondemand_value::get_boolean() const {
+  if (has_error()) {
+    return left(error);
+  }
+  auto p = ptr;
+  bool result;
+  if (scan_json_literal(p, end, "true", 4)) {
+    result = true;
+  } else if (scan_json_literal(p, end, "false", 5)) {
+    result = false;
+  } else {
+    return left(json_parse_error::incorrect_type);
+  }
+  if (!is_json_boundary(p, end)) {
+    return left(json_parse_error::unexpected_character);
+  }
+  return right(result);
+}
+
+either<json_parse_error, bigint> json_ondemand_value::get_integer() const {
+  if (has_error()) {
+    return left(error);
+  }
+  if (*ptr != '-' && !is_json_digit(*ptr)) {
+    return left(json_parse_error::incorrect_type);
+  }
+  auto p = ptr;
+  auto number = scan_json_number(p, end);
+  ZEN_TRY(number);
+  if (!is_json_boundary(p, end)) {
+    return left(json_parse_error::unexpected_character);
+  }
+  if (!number->is_integer) {
+    return left(json_parse_error::incorrect_type);
+  }
+  return right(number->integer);
+}
+
+either<json_parse_error, fractional> json_ondemand_value::get_fractional() const {
+  if (has_error()) {
+    return left(error);
+  }
+  if (*ptr != '-' && !is_json_digit(*ptr)) {
+    return left(json_parse_error::incorrect_type);
+  }
+  auto p = ptr;
+  auto number = scan_json_number(p, end);
+  ZEN_TRY(number);
+  if (!is_json_boundary(p, end)) {
+    return left(json_parse_error::unexpected_character);
+  }
+  return right(number->is_integer ? static_cast<fractional>(number->integer) : number->fraction);
+}
+
+either<json_parse_error, string> json_ondemand_value::get_string() const {
+  if (has_error()) {
+    return left(error);
+  }
+  if (*ptr != '"') {
+    return left(json_parse_error::incorrect_type);
+  }
+  auto p = ptr + 1;
+  string result;
+  ZEN_TRY_DISCARD(scan_json_string(p, end, result));
+  return right(std::move(result));
+}
+
+either<json_parse_error, value> json_ondemand_value::get_value() const {
+  auto raw = get_raw_json();
+  ZEN_TRY(raw);
+  return parse_json(raw->data(), raw->size());
+}
+
+json_ondemand_value parse_json_ondemand(const char* data, std::size_t size) {
+  auto end = data + size;
+  auto ptr = skip_json_whitespace(data, end);
+  if (ptr == end) {
+    return json_ondemand_value(json_parse_error::unexpected_end_of_input);
+  }
+  return json_ondemand_value(ptr, end);
+}
+
+json_ondemand_value parse_json_ondemand(std::string_view in) {
+  return parse_json_ondemand(in.data(), in.size());
 }
 
 // std::unique_ptr<transformer> make_json_decoder(
@@ -0,0 +1,269 @@
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include "zen/config.hpp"
+#include "zen/json.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ZEN_JSON_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define ZEN_JSON_HAVE_X86_KERNELS 0
+#endif
+
+ZEN_NAMESPACE_START
+
+#define ZEN_JSON_BLOCK_SIZE 64
+
+/// The characters of one block of 64 bytes, classified as bitmasks.
+///
+/// Bit `i` of each mask corresponds to byte `i` of the block.
+struct json_block_masks {
+  std::uint64_t quote;
+  std::uint64_t backslash;
+  std::uint64_t whitespace;
+  std::uint64_t op;
+};
+
+using classify_block_fn = void (*)(const char* block, json_block_masks& masks);
+
+enum : unsigned char {
+  json_char_other = 0,
+  json_char_quote = 1,
+  json_char_backslash = 2,
+  json_char_whitespace = 4,
+  json_char_op = 8,
+};
+
+struct json_char_table {
+
+  unsigned char classes[256] = {};
+
+  constexpr json_char_table() {
+    classes[static_cast<unsigned char>('"')] = json_char_quote;
+    classes[static_cast<unsigned char>('\\')] = json_char_backslash;
+    classes[static_cast<unsigned char>(' ')] = json_char_whitespace;
+    classes[static_cast<unsigned char>('\t')] = json_char_whitespace;
+    classes[static_cast<unsigned char>('\n')] = json_char_whitespace;
+    classes[static_cast<unsigned char>('\r')] = json_char_whitespace;
+    classes[static_cast<unsigned char>('{')] = json_char_op;
+    classes[static_cast<unsigned char>('}')] = json_char_op;
+    classes[static_cast<unsigned char>('[')] = json_char_op;
+    classes[static_cast<unsigned char>(']')] = json_char_op;
+    classes[static_cast<unsigned char>(':')] = json_char_op;
+    classes[static_cast<unsigned char>(',')] = json_char_op;
+  }
+
+};
+
+static constexpr json_char_table char_table;
+
+static void classify_block_scalar(const char* block, json_block_masks& masks) {
+  std::uint64_t quote = 0;
+  std::uint64_t backslash = 0;
+  std::uint64_t whitespace = 0;
+  std::uint64_t op = 0;
+  for (std::size_t i = 0; i < ZEN_JSON_BLOCK_SIZE; ++i) {
+    auto cls = char_table.classes[static_cast<unsigned char>(block[i])];
+    quote |= std::uint64_t(cls & json_char_quote) << i;
+    backslash |= std::uint64_t((cls & json_char_backslash) >> 1) << i;
+    whitespace |= std::uint64_t((cls & json_char_whitespace) >> 2) << i;
+    op |= std::uint64_t((cls & json_char_op) >> 3) << i;
+  }
+  masks.quote = quote;
+  masks.backslash = backslash;
+  masks.whitespace = whitespace;
+  masks.op = op;
+}
+
+#if ZEN_JSON_HAVE_X86_KERNELS
+
+// Whitespace and operators are found with a table lookup on the low nibble of
+// each byte, after which the looked-up byte is compared with the original
+// byte. Bytes with the high bit set are mapped to zero by the lookup and can
+// therefore never match. For operators, the byte is first OR'ed with 0x20 so
+// that `[` and `]` map onto `{` and `}`. The few control characters that
+// match as well are invalid outside of strings and are rejected by the second
+// stage.
+
+#define ZEN_JSON_WHITESPACE_TABLE \
+  ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100
+
+#define ZEN_JSON_OP_TABLE \
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0
+
+__attribute__((target("sse4.2")))
+static void classify_block_sse42(const char* block, json_block_masks& masks) {
+  const __m128i whitespace_table = _mm_setr_epi8(ZEN_JSON_WHITESPACE_TABLE);
+  const __m128i op_table = _mm_setr_epi8(ZEN_JSON_OP_TABLE);
+  const __m128i quote_char = _mm_set1_epi8('"');
+  const __m128i backslash_char = _mm_set1_epi8('\\');
+  const __m128i lower_bit = _mm_set1_epi8(0x20);
+  std::uint64_t quote = 0;
+  std::uint64_t backslash = 0;
+  std::uint64_t whitespace = 0;
+  std::uint64_t op = 0;
+  for (std::size_t i = 0; i < ZEN_JSON_BLOCK_SIZE; i += 16) {
+    auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+    auto is_quote = _mm_cmpeq_epi8(in, quote_char);
+    auto is_backslash = _mm_cmpeq_epi8(in, backslash_char);
+    auto is_whitespace = _mm_cmpeq_epi8(in, _mm_shuffle_epi8(whitespace_table, in));
+    auto is_op = _mm_cmpeq_epi8(_mm_or_si128(in, lower_bit), _mm_shuffle_epi8(op_table, in));
+    quote |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(is_quote))) << i;
+    backslash |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(is_backslash))) << i;
+    whitespace |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(is_whitespace))) << i;
+    op |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(is_op))) << i;
+  }
+  masks.quote = quote;
+  masks.backslash = backslash;
+  masks.whitespace = whitespace;
+  masks.op = op;
+}
+
+__attribute__((target("avx2")))
+static void classify_block_avx2(const char* block, json_block_masks& masks) {
+  const __m256i whitespace_table = _mm256_setr_epi8(ZEN_JSON_WHITESPACE_TABLE, ZEN_JSON_WHITESPACE_TABLE);
+  const __m256i op_table = _mm256_setr_epi8(ZEN_JSON_OP_TABLE, ZEN_JSON_OP_TABLE);
+  const __m256i quote_char = _mm256_set1_epi8('"');
+  const __m256i backslash_char = _mm256_set1_epi8('\\');
+  const __m256i lower_bit = _mm256_set1_epi8(0x20);
+  std::uint64_t quote = 0;
+  std::uint64_t backslash = 0;
+  std::uint64_t whitespace = 0;
+  std::uint64_t op = 0;
+  for (std::size_t i = 0; i < ZEN_JSON_BLOCK_SIZE; i += 32) {
+    auto in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+    auto is_quote = _mm256_cmpeq_epi8(in, quote_char);
+    auto is_backslash = _mm256_cmpeq_epi8(in, backslash_char);
+    auto is_whitespace = _mm256_cmpeq_epi8(in, _mm256_shuffle_epi8(whitespace_table, in));
+    auto is_op = _mm256_cmpeq_epi8(_mm256_or_si256(in, lower_bit), _mm256_shuffle_epi8(op_table, in));
+    quote |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(is_quote))) << i;
+    backslash |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(is_backslash))) << i;
+    whitespace |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(is_whitespace))) << i;
+    op |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(is_op))) << i;
+  }
+  masks.quote = quote;
+  masks.backslash = backslash;
+  masks.whitespace = whitespace;
+  masks.op = op;
+}
+
+#endif // of #if ZEN_JSON_HAVE_X86_KERNELS
+
+static classify_block_fn select_kernel(json_index_kernel kernel) {
+#if ZEN_JSON_HAVE_X86_KERNELS
+  switch (kernel) {
+    case json_index_kernel::automatic:
+    {
+      static const classify_block_fn best =
+          __builtin_cpu_supports("avx2") ? classify_block_avx2
+        : __builtin_cpu_supports("sse4.2") ? classify_block_sse42
+        : classify_block_scalar;
+      return best;
+    }
+    case json_index_kernel::avx2:
+      if (__builtin_cpu_supports("avx2")) {
+        return classify_block_avx2;
+      }
+      break;
+    case json_index_kernel::sse42:
+      if (__builtin_cpu_supports("sse4.2")) {
+        return classify_block_sse42;
+      }
+      break;
+    case json_index_kernel::scalar:
+      break;
+  }
+#endif
+  return classify_block_scalar;
+}
+
+/// Compute for every byte whether it is preceded by an odd amount of
+/// backslashes, i.e. whether it is escaped.
+///
+/// @p prev_escaped carries over whether the first byte of the next block is
+/// escaped.
+static std::uint64_t find_escaped(std::uint64_t backslash, std::uint64_t& prev_escaped) {
+  const std::uint64_t even_bits = 0x5555555555555555ULL;
+  backslash &= ~prev_escaped;
+  auto follows_escape = backslash << 1 | prev_escaped;
+  auto odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+  auto sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+  prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts;
+  auto invert_mask = sequences_starting_on_even_bits << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+/// Set every bit that has an odd amount of set bits at or below it.
+static std::uint64_t prefix_xor(std::uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+bool index_json(
+  const char* data,
+  std::size_t size,
+  json_structural_index& out,
+  json_index_kernel kernel
+) {
+
+  auto classify = select_kernel(kernel);
+
+  std::size_t count = 0;
+  out.clear();
+
+  std::uint64_t prev_escaped = 0;
+  std::uint64_t prev_in_string = 0;
+  std::uint64_t prev_scalar = 0;
+
+  char tail[ZEN_JSON_BLOCK_SIZE];
+
+  for (std::size_t offset = 0; offset < size; offset += ZEN_JSON_BLOCK_SIZE) {
+
+    const char* block = data + offset;
+    if (ZEN_UNLIKELY(size - offset < ZEN_JSON_BLOCK_SIZE)) {
+      std::memset(tail, ' ', ZEN_JSON_BLOCK_SIZE);
+      std::memcpy(tail, block, size - offset);
+      block = tail;
+    }
+
+    json_block_masks masks;
+    classify(block, masks);
+
+    auto escaped = find_escaped(masks.backslash, prev_escaped);
+    auto quote = masks.quote & ~escaped;
+    auto in_string = prefix_xor(quote) ^ prev_in_string;
+    prev_in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+
+    auto scalar = ~(masks.op | masks.whitespace | quote | in_string);
+    auto scalar_start = scalar & ~(scalar << 1 | prev_scalar);
+    prev_scalar = scalar >> 63;
+
+    auto structurals = (masks.op & ~in_string) | (quote & in_string) | scalar_start;
+
+    if (out.size() < count + ZEN_JSON_BLOCK_SIZE) {
+      out.resize(std::max(out.size() * 2, count + ZEN_JSON_BLOCK_SIZE));
+    }
+    auto dest = out.data() + count;
+    while (structurals) {
+      *dest++ = static_cast<std::uint32_t>(offset + std::countr_zero(structurals));
+      structurals &= structurals - 1;
+    }
+    count = dest - out.data();
+
+  }
+
+  out.resize(count);
+
+  return prev_in_string == 0;
+}
+
+ZEN_NAMESPACE_END
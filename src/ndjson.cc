@@ -0,0 +1,247 @@
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "zen/config.hpp"
+#include "zen/fs/io.hpp"
+#include "zen/ndjson.hpp"
+
+ZEN_NAMESPACE_START
+
+/// The maximum amount of chunks that may be parsed ahead of the chunk that is
+/// being handed back, per worker thread, when the output is ordered.
+#define ZEN_NDJSON_CHUNKS_IN_FLIGHT_PER_THREAD 4
+
+struct ndjson_chunk {
+  const char* begin;
+  const char* end;
+  std::vector<std::pair<std::size_t, json_parse_result>> results;
+  bool done = false;
+
+  ndjson_chunk(const char* begin, const char* end):
+    begin(begin), end(end) {}
+};
+
+static bool is_blank(const char* ptr, const char* end) {
+  for (; ptr != end; ++ptr) {
+    switch (*ptr) {
+      case ' ':
+      case '\t':
+      case '\r':
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+template<typename F>
+static void parse_ndjson_lines(const char* base, const char* ptr, const char* end, F&& emit) {
+  while (ptr != end) {
+    auto newline = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+    auto line_end = newline == nullptr ? end : newline;
+    if (!is_blank(ptr, line_end)) {
+      emit(static_cast<std::size_t>(ptr - base), parse_json(ptr, line_end - ptr));
+    }
+    ptr = newline == nullptr ? end : newline + 1;
+  }
+}
+
+static std::vector<ndjson_chunk> split_ndjson(std::string_view in, std::size_t chunk_size) {
+  std::vector<ndjson_chunk> chunks;
+  auto ptr = in.data();
+  auto end = in.data() + in.size();
+  while (ptr != end) {
+    auto chunk_end = ptr + std::min(chunk_size, static_cast<std::size_t>(end - ptr));
+    if (chunk_end != end) {
+      auto newline = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+      chunk_end = newline == nullptr ? end : newline + 1;
+    }
+    chunks.emplace_back(ptr, chunk_end);
+    ptr = chunk_end;
+  }
+  return chunks;
+}
+
+void parse_ndjson(std::string_view in, const ndjson_callback& callback, ndjson_opts opts) {
+
+  auto base = in.data();
+
+  auto threads = opts.threads == 0 ? std::thread::hardware_concurrency() : opts.threads;
+  auto chunks = split_ndjson(in, std::max<std::size_t>(opts.chunk_size, 1));
+
+  if (threads <= 1 || chunks.size() <= 1) {
+    parse_ndjson_lines(base, base, base + in.size(), callback);
+    return;
+  }
+
+  threads = std::min(threads, chunks.size());
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+
+  if (!opts.ordered) {
+    // The first exception that escapes the callback stops every worker and
+    // is rethrown on the calling thread once they have all finished.
+    std::atomic<std::size_t> next_chunk = 0;
+    std::atomic<bool> stop = false;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([&] {
+        try {
+          while (!stop.load(std::memory_order_relaxed)) {
+            auto k = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (k >= chunks.size()) {
+              break;
+            }
+            parse_ndjson_lines(base, chunks[k].begin, chunks[k].end, callback);
+          }
+        } catch (...) {
+          std::lock_guard lock { error_mutex };
+          if (!error) {
+            error = std::current_exception();
+          }
+          stop.store(true, std::memory_order_relaxed);
+        }
+      });
+    }
+    for (auto& worker: workers) {
+      worker.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return;
+  }
+
+  // Workers may only run a bounded amount of chunks ahead of the chunk that is
+  // being handed back, so that memory use does not grow with the input when
+  // one chunk takes a long time to parse.
+  auto max_in_flight = threads * ZEN_NDJSON_CHUNKS_IN_FLIGHT_PER_THREAD;
+
+  std::mutex mutex;
+  std::condition_variable chunk_done;
+  std::condition_variable chunk_consumed;
+  std::size_t next_chunk = 0;
+  std::size_t consumed = 0;
+
+  /// Set when the workers must give up, either because one of them failed
+  /// or because the callback threw on the calling thread.
+  bool stop = false;
+  std::exception_ptr error;
+
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      try {
+        for (;;) {
+          std::size_t k;
+          {
+            std::unique_lock lock { mutex };
+            chunk_consumed.wait(lock, [&] {
+              return stop || next_chunk >= chunks.size() || next_chunk < consumed + max_in_flight;
+            });
+            if (stop || next_chunk >= chunks.size()) {
+              break;
+            }
+            k = next_chunk++;
+          }
+          auto& chunk = chunks[k];
+          parse_ndjson_lines(base, chunk.begin, chunk.end, [&](std::size_t offset, json_parse_result result) {
+            chunk.results.emplace_back(offset, std::move(result));
+          });
+          {
+            std::lock_guard lock { mutex };
+            chunk.done = true;
+          }
+          chunk_done.notify_all();
+        }
+      } catch (...) {
+        {
+          std::lock_guard lock { mutex };
+          if (!error) {
+            error = std::current_exception();
+          }
+          stop = true;
+        }
+        chunk_done.notify_all();
+        chunk_consumed.notify_all();
+      }
+    });
+  }
+
+  auto stop_workers = [&] {
+    {
+      std::lock_guard lock { mutex };
+      stop = true;
+    }
+    chunk_consumed.notify_all();
+    for (auto& worker: workers) {
+      worker.join();
+    }
+  };
+
+  try {
+    for (std::size_t k = 0; k < chunks.size(); ++k) {
+      auto& chunk = chunks[k];
+      {
+        std::unique_lock lock { mutex };
+        chunk_done.wait(lock, [&] { return chunk.done || stop; });
+        if (!chunk.done) {
+          break;
+        }
+      }
+      for (auto& [offset, result]: chunk.results) {
+        callback(offset, std::move(result));
+      }
+      chunk.results = {};
+      {
+        std::lock_guard lock { mutex };
+        consumed = k + 1;
+      }
+      chunk_consumed.notify_all();
+    }
+  } catch (...) {
+    stop_workers();
+    throw;
+  }
+
+  stop_workers();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+std::vector<json_parse_result> parse_ndjson(std::string_view in, ndjson_opts opts) {
+  std::vector<json_parse_result> results;
+  opts.ordered = true;
+  parse_ndjson(in, [&](std::size_t, json_parse_result result) {
+    results.push_back(std::move(result));
+  }, opts);
+  return results;
+}
+
+either<std::error_code, void> parse_ndjson_file(
+  const fs::path& filename,
+  const ndjson_callback& callback,
+  ndjson_opts opts
+) {
+
+  auto file = fs::map_file(filename);
+  if (!file) {
+    return left(file.left());
+  }
+
+  parse_ndjson(file->as_string_view(), callback, opts);
+
+  return right();
+}
+
+ZEN_NAMESPACE_END
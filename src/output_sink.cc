@@ -0,0 +1,38 @@
+
+#ifdef __unix__
+#include <unistd.h>
+#else
+#error "unsupported platform"
+#endif
+
+#include <cerrno>
+
+#include "zen/output_sink.hpp"
+
+ZEN_NAMESPACE_START
+
+void output_sink::grow(std::size_t min_capacity) {
+  ZEN_ASSERT(size == 0);
+  auto new_capacity = capacity * 2;
+  if (new_capacity < min_capacity) {
+    new_capacity = min_capacity;
+  }
+  buffer.reset(new char[new_capacity]);
+  capacity = new_capacity;
+}
+
+void fd_sink::write_through(const char* data, std::size_t size) {
+  while (size > 0 && !error) {
+    auto count = ::write(fd, data, size);
+    if (count == -1) {
+      if (errno != EINTR) {
+        error = std::error_code { errno, std::system_category() };
+      }
+      continue;
+    }
+    data += count;
+    size -= count;
+  }
+}
+
+ZEN_NAMESPACE_END
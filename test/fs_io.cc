@@ -1,3 +1,5 @@
+#include <filesystem>
+#include <fstream>
 
 #include "gtest/gtest.h"
 
@@ -7,3 +9,44 @@ TEST(FSIOTest, CanReadFile) {
   auto text = zen::fs::read_file("test/lorem.txt").unwrap();
   ASSERT_EQ(text, "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Donec ultricies felis leo, in iaculis elit tristique a. Aliquam ultrices tincidunt turpis. Ut sit amet felis metus. Pellentesque in dui velit. Proin auctor sollicitudin turpis, ut facilisis leo rutrum et. Class aptent taciti sociosqu ad litora torquent per conubia nostra, per inceptos himenaeos. Cras rhoncus est eu magna consectetur laoreet et sed quam. Praesent sit amet interdum massa. Pellentesque vehicula fermentum risus hendrerit lobortis. Fusce facilisis eros vitae rutrum mattis. Cras fringilla est vel arcu rhoncus, a tincidunt tellus sodales. Integer lacinia porta lacus at efficitur. Donec dictum ante non mi tincidunt, vel fringilla lorem scelerisque. Cras bibendum eget purus convallis tristique. Etiam et ultricies urna, non rutrum metus.\n");
 }
+
+TEST(FSIOTest, CanMapFile) {
+  auto expected = zen::fs::read_file("test/lorem.txt").unwrap();
+  auto file = zen::fs::map_file("test/lorem.txt", { .will_need = true }).unwrap();
+  ASSERT_EQ(file.size(), expected.size());
+  ASSERT_TRUE(file.as_bytestring_view() == expected);
+  ASSERT_TRUE(file.as_string_view().starts_with("Lorem ipsum"));
+  auto moved = std::move(file);
+  ASSERT_TRUE(file.empty());
+  ASSERT_EQ(moved.as_string_view().back(), '\n');
+}
+
+TEST(FSIOTest, MapFileReportsErrors) {
+  auto result = zen::fs::map_file("test/does-not-exist.txt");
+  ASSERT_FALSE(result.is_right());
+  ASSERT_EQ(result.left(), std::errc::no_such_file_or_directory);
+}
+
+TEST(FSIOTest, CanReadFileInSmallBlocks) {
+  auto expected = zen::fs::read_file("test/lorem.txt").unwrap();
+  auto text = zen::fs::read_file("test/lorem.txt", { .block_size = 7, .sequential = false }).unwrap();
+  ASSERT_EQ(text.size(), expected.size());
+  ASSERT_EQ(text, expected);
+}
+
+TEST(FSIOTest, CanReadFileWithUnknownSize) {
+  auto text = zen::fs::read_file("/proc/self/status", { .block_size = 16 }).unwrap();
+  ASSERT_GT(text.size(), 16);
+  ASSERT_TRUE(text.to_std_string().starts_with("Name:"));
+}
+
+TEST(FSIOTest, EmptyFilesTakeNoBuffer) {
+  auto filename = std::filesystem::temp_directory_path() / "zen-fs-io-empty.txt";
+  std::ofstream { filename };
+  auto text = zen::fs::read_file(filename.string()).unwrap();
+  std::filesystem::remove(filename);
+  ASSERT_EQ(text.size(), 0);
+  ASSERT_LE(text.capacity(), 1);
+  auto status = zen::fs::read_file("/proc/self/status").unwrap();
+  ASSERT_LT(status.capacity(), 1024 * 1024);
+}
@@ -0,0 +1,53 @@
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "zen/bytestring.hpp"
+#include "zen/hash.hpp"
+
+TEST(Hash, StringsHashTheSameThroughAnyView) {
+  std::string str = "a key that is longer than sixteen bytes";
+  auto h = zen::hash<std::string>{}(str);
+  ASSERT_EQ(zen::hash<std::string_view>{}(str), h);
+  ASSERT_EQ(zen::string_hash{}(str.c_str()), h);
+  ASSERT_EQ(zen::bytestring(str.c_str()).size(), str.size());
+  ASSERT_EQ(std::hash<zen::bytestring>{}(zen::bytestring(str.c_str())), h);
+}
+
+TEST(Hash, DependsOnEveryByte) {
+  // Every length exercises a different combination of loads, so flipping
+  // any one bit of the input must change the hash.
+  char buffer[200];
+  std::memset(buffer, 'x', sizeof(buffer));
+  for (std::size_t size = 1; size < sizeof(buffer); ++size) {
+    auto h = zen::hash_bytes(buffer, size);
+    for (std::size_t i = 0; i < size; ++i) {
+      buffer[i] ^= 1;
+      ASSERT_NE(zen::hash_bytes(buffer, size), h) << "size " << size << " byte " << i;
+      buffer[i] ^= 1;
+    }
+    ASSERT_NE(zen::hash_bytes(buffer, size + 1), h);
+  }
+}
+
+TEST(Hash, SpreadsSimilarKeysOverBuckets) {
+  const std::size_t num_buckets = 256;
+  const std::size_t count = 256 * 100;
+  std::vector<std::size_t> string_buckets(num_buckets);
+  std::vector<std::size_t> integer_buckets(num_buckets);
+  for (std::size_t i = 0; i < count; ++i) {
+    ++string_buckets[zen::hash<std::string>{}("key" + std::to_string(i)) % num_buckets];
+    ++integer_buckets[zen::hash<std::size_t>{}(i * num_buckets) % num_buckets];
+  }
+  for (std::size_t i = 0; i < num_buckets; ++i) {
+    ASSERT_GT(string_buckets[i], 50);
+    ASSERT_LT(string_buckets[i], 150);
+    ASSERT_GT(integer_buckets[i], 50);
+    ASSERT_LT(integer_buckets[i], 150);
+  }
+}
@@ -0,0 +1,77 @@
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "zen/hash_index.hpp"
+
+struct get_first {
+  int operator()(const std::pair<int, std::string>& element) const noexcept {
+    return element.first;
+  }
+};
+
+TEST(HashIndex, CanInsertLookUpAndErase) {
+  zen::hash_index<std::size_t> index;
+  const std::size_t count = 100000;
+  for (std::size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(index.insert(i * 7).second);
+  }
+  ASSERT_FALSE(index.insert(14).second);
+  ASSERT_EQ(index.size(), count);
+  ASSERT_LE(index.load_factor(), 0.875);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto it = index.lookup(i * 7);
+    ASSERT_NE(it, index.end());
+    ASSERT_EQ(*it, i * 7);
+    ASSERT_FALSE(index.contains(i * 7 + 1));
+  }
+  for (std::size_t i = 0; i < count; i += 2) {
+    ASSERT_EQ(index.erase(i * 7), 1);
+  }
+  ASSERT_EQ(index.erase(std::size_t(0)), 0);
+  ASSERT_EQ(index.size(), count / 2);
+  for (std::size_t i = 0; i < count; ++i) {
+    ASSERT_EQ(index.contains(i * 7), i % 2 == 1);
+  }
+  std::size_t visited = 0;
+  for (auto element: index) {
+    ASSERT_EQ(element % 14, 7);
+    ++visited;
+  }
+  ASSERT_EQ(visited, count / 2);
+}
+
+TEST(HashIndex, ReusesTombstones) {
+  zen::hash_index<int> index;
+  index.reserve(100);
+  auto capacity = index.capacity();
+  for (int round = 0; round < 1000; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      index.insert(round * 100 + i);
+    }
+    for (int i = 0; i < 100; ++i) {
+      index.erase(round * 100 + i);
+    }
+  }
+  ASSERT_TRUE(index.empty());
+  ASSERT_EQ(index.capacity(), capacity);
+}
+
+TEST(HashIndex, SupportsCustomKeysAndCopies) {
+  zen::hash_index<std::pair<int, std::string>, int, std::allocator<std::pair<int, std::string>>, get_first> index;
+  for (int i = 0; i < 1000; ++i) {
+    index.insert({ i, std::to_string(i) });
+  }
+  auto copy = index;
+  index.clear();
+  ASSERT_FALSE(index.contains(1));
+  ASSERT_EQ(copy.size(), 1000);
+  ASSERT_EQ(copy.lookup(123)->second, "123");
+  auto moved = std::move(copy);
+  moved.erase(moved.lookup(123));
+  ASSERT_FALSE(moved.contains(123));
+  ASSERT_EQ(moved.size(), 999);
+}
@@ -1,9 +1,18 @@
 
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <string>
 
 #include "gtest/gtest.h"
 
+#include "zen/bump_ptr_pool.hpp"
 #include "zen/json.hpp"
+#include "zen/json_document.hpp"
+#include "zen/json_ondemand.hpp"
 
 // TODO Simplify these tests by using Unicode-style string literals.
 
@@ -122,3 +131,473 @@ TEST(JsonParse, CanParseFractional) {
   ASSERT_TRUE(r1.is_fractional());
   ASSERT_EQ(r1.as_fractional(), 2.3);
 }
+
+TEST(JsonParse, CanParseIntegersAtTheLimits) {
+  ASSERT_EQ(zen::parse_json("9223372036854775807").unwrap().as_integer(), std::numeric_limits<zen::bigint>::max());
+  ASSERT_EQ(zen::parse_json("-9223372036854775808").unwrap().as_integer(), std::numeric_limits<zen::bigint>::min());
+  ASSERT_EQ(zen::parse_json("[12345678901234, -0]").unwrap().as_array()[0].as_integer(), 12345678901234);
+  for (auto in: { "9223372036854775808", "-9223372036854775809", "123456789012345678901234" }) {
+    auto r1 = zen::parse_json(in);
+    ASSERT_TRUE(r1.is_left() && r1.left() == zen::json_parse_error::number_out_of_range) << in;
+    std::istringstream s1 { in };
+    auto r2 = zen::parse_json(s1);
+    ASSERT_TRUE(r2.is_left() && r2.left() == zen::json_parse_error::number_out_of_range) << in;
+  }
+}
+
+TEST(JsonParse, RoundTripsFractionals) {
+  std::mt19937_64 rng { 42 };
+  std::uniform_real_distribution<double> exponent { -300, 300 };
+  for (std::size_t i = 0; i < 20000; ++i) {
+    double expected = std::pow(10.0, exponent(rng)) * (rng() % 2 ? 1 : -1);
+    if (i % 2 == 0) {
+      expected = static_cast<double>(rng() % 100000000) / 1000;
+    }
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", expected);
+    std::string text = buffer;
+    if (text.find_first_of(".e") == std::string::npos) {
+      text += ".0";
+    }
+    auto r1 = zen::parse_json(text).unwrap();
+    ASSERT_EQ(r1.as_fractional(), expected) << text;
+    std::istringstream s1 { text };
+    ASSERT_EQ(zen::parse_json(s1).unwrap().as_fractional(), expected) << text;
+  }
+  ASSERT_EQ(zen::parse_json("1e-400").unwrap().as_fractional(), 0.0);
+  ASSERT_EQ(zen::parse_json("0.12345678901234567890123").unwrap().as_fractional(), 0.12345678901234567890123);
+  auto r2 = zen::parse_json("-1.5e400");
+  ASSERT_TRUE(r2.is_left() && r2.left() == zen::json_parse_error::number_out_of_range);
+}
+
+TEST(JsonParse, CanParseNumbersAndEscapesFromStream) {
+  std::istringstream s1 { "[-12, 1.5e3, -2.5E-1, \"\\u00e9\\ud83d\\ude00\"]" };
+  auto r1 = zen::parse_json(s1).unwrap();
+  auto& a1 = r1.as_array();
+  ASSERT_EQ(a1[0].as_integer(), -12);
+  ASSERT_EQ(a1[1].as_fractional(), 1500);
+  ASSERT_EQ(a1[2].as_fractional(), -0.25);
+  ASSERT_EQ(a1[3].as_string(), "\xC3\xA9\xF0\x9F\x98\x80");
+  std::istringstream s2 { "[1.]" };
+  ASSERT_TRUE(zen::parse_json(s2).is_left());
+}
+
+static zen::json_structural_index naive_index_json(const std::string& text) {
+  zen::json_structural_index out;
+  bool in_string = false;
+  bool in_scalar = false;
+  bool escaped = false;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    auto ch = text[i];
+    // Backslashes escape the next character even outside of strings
+    if (escaped && ch == '"') {
+      ch = 'a';
+    }
+    escaped = !in_string && !escaped && ch == '\\';
+    if (in_string) {
+      if (ch == '\\') {
+        ++i;
+      } else if (ch == '"') {
+        in_string = false;
+      }
+      continue;
+    }
+    switch (ch) {
+      case '"':
+        out.push_back(i);
+        in_string = true;
+        in_scalar = false;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        out.push_back(i);
+        in_scalar = false;
+        break;
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        in_scalar = false;
+        break;
+      default:
+        if (!in_scalar) {
+          out.push_back(i);
+          in_scalar = true;
+        }
+        break;
+    }
+  }
+  return out;
+}
+
+TEST(JsonIndex, AllKernelsAgreeWithNaiveIndex) {
+  const char alphabet[] = "{}[]:,\"\\ \nab1\xc3";
+  std::uint64_t seed = 42;
+  for (auto round = 0; round < 500; ++round) {
+    std::string text;
+    auto size = round % 200;
+    for (auto i = 0; i < size; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      text.push_back(alphabet[(seed >> 33) % (sizeof(alphabet) - 1)]);
+    }
+    auto expected = naive_index_json(text);
+    for (auto kernel: { zen::json_index_kernel::scalar, zen::json_index_kernel::sse42, zen::json_index_kernel::avx2 }) {
+      zen::json_structural_index actual;
+      zen::index_json(text.data(), text.size(), actual, kernel);
+      ASSERT_EQ(actual, expected) << "input: " << text;
+    }
+  }
+}
+
+TEST(JsonParseIndexed, CanParseScalars) {
+  ASSERT_EQ(zen::parse_json_indexed("1234567890").unwrap().as_integer(), 1234567890);
+  ASSERT_EQ(zen::parse_json_indexed("-12").unwrap().as_integer(), -12);
+  ASSERT_EQ(zen::parse_json_indexed("2.3").unwrap().as_fractional(), 2.3);
+  ASSERT_EQ(zen::parse_json_indexed("2.5e2").unwrap().as_fractional(), 250.0);
+  ASSERT_TRUE(zen::parse_json_indexed(" true ").unwrap().is_true());
+  ASSERT_TRUE(zen::parse_json_indexed("false").unwrap().is_false());
+  ASSERT_TRUE(zen::parse_json_indexed("null").unwrap().is_null());
+  ASSERT_EQ(zen::parse_json_indexed("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"").unwrap().as_string(), "\"\\/\b\f\n\r\t");
+  ASSERT_EQ(zen::parse_json_indexed("\"\\u00e9\\ud83d\\ude00\"").unwrap().as_string(), "\xc3\xa9\xf0\x9f\x98\x80");
+}
+
+TEST(JsonParseIndexed, CanParseNestedDocument) {
+  std::string text = "{\"name\": \"a string that is long enough to cross a block boundary\", \"items\": [1, [2, 3], {}, [], {\"x\": null}], \"escaped\\\"key\": \"\\\\\"}";
+  auto r1 = zen::parse_json_indexed(text).unwrap();
+  ASSERT_TRUE(r1.is_object());
+  auto& o1 = r1.as_object();
+  ASSERT_EQ(o1.size(), 3);
+  auto it = o1.cbegin();
+  ASSERT_EQ(it->first, "name");
+  ASSERT_EQ(it->second.as_string(), "a string that is long enough to cross a block boundary");
+  ++it;
+  ASSERT_EQ(it->first, "items");
+  auto& a1 = it->second.as_array();
+  ASSERT_EQ(a1.size(), 5);
+  ASSERT_EQ(a1[0].as_integer(), 1);
+  ASSERT_EQ(a1[1].as_array().size(), 2);
+  ASSERT_EQ(a1[1].as_array()[1].as_integer(), 3);
+  ASSERT_TRUE(a1[2].as_object().empty());
+  ASSERT_TRUE(a1[3].as_array().empty());
+  ASSERT_TRUE(a1[4].is_object());
+  ++it;
+  ASSERT_EQ(it->first, "escaped\"key");
+  ASSERT_EQ(it->second.as_string(), "\\");
+}
+
+TEST(JsonParseIndexed, RejectsInvalidDocuments) {
+  for (auto text: { "", " ", "@", " [ 1 @ ]", " [ 1 , @ ]", ",", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "1 2", "tru", "truex", "12a", "01", "-", "1.", "1e", "[1}", "{\"a\":1]", "\"abc", "\"a\nb\"", "\"\\x\"", "[", "x\"", "{\"a\":1}\"", "[1 \"", "[\"a\", \"b" }) {
+    auto result = zen::parse_json_indexed(text);
+    ASSERT_TRUE(result.is_left()) << "input: " << text;
+    // The same bad input must be reported with the same error as parse_json.
+    ASSERT_TRUE(result.left() == zen::parse_json(std::string(text)).left()) << "input: " << text;
+  }
+}
+
+TEST(JsonParse, CanParseFromContiguousBuffers) {
+  const char text[] = "{\"foo\": [1, 2.5, \"bar\"], \"baz\": true}";
+  std::string_view view { text };
+  zen::bytestring bytes { text };
+  for (auto r1: { zen::parse_json(text, sizeof(text) - 1), zen::parse_json(view), zen::parse_json(bytes), zen::parse_json(std::string(text)) }) {
+    ASSERT_TRUE(r1.is_right());
+    auto v1 = r1.unwrap();
+    auto& o1 = v1.as_object();
+    ASSERT_EQ(o1.size(), 2);
+    auto it = o1.cbegin();
+    ASSERT_EQ(it->first, "foo");
+    ASSERT_EQ(it->second.as_array().size(), 3);
+    ASSERT_EQ(it->second.as_array()[2].as_string(), "bar");
+  }
+}
+
+TEST(JsonParse, DoesNotReadPastTheGivenSize) {
+  const char text[] = "[1, 2]garbage";
+  auto r1 = zen::parse_json(text, 6).unwrap();
+  ASSERT_EQ(r1.as_array().size(), 2);
+  ASSERT_TRUE(zen::parse_json(text, 5).is_left());
+  ASSERT_TRUE(zen::parse_json("tru", 3).is_left());
+  ASSERT_TRUE(zen::parse_json("\"ab", 3).is_left());
+}
+
+TEST(JsonDocument, CanNavigateParsedDocument) {
+  auto doc = zen::parse_json_document("{\"user\": {\"id\": 42, \"name\": \"J\\u00f6rg\"}, \"scores\": [1.5, -2, true, null, []], \"empty\": {}}").unwrap();
+  auto root = doc.root();
+  ASSERT_TRUE(root.is_object());
+  ASSERT_EQ(root.size(), 3);
+  auto user = root["user"];
+  ASSERT_EQ(user.size(), 2);
+  ASSERT_EQ(user["id"].as_integer(), 42);
+  ASSERT_EQ(user["name"].as_string(), "J\xc3\xb6rg");
+  ASSERT_FALSE(user.find("missing").has_value());
+  auto scores = root["scores"];
+  ASSERT_TRUE(scores.is_array());
+  ASSERT_EQ(scores.size(), 5);
+  ASSERT_EQ(scores[0].as_fractional(), 1.5);
+  ASSERT_EQ(scores[1].as_integer(), -2);
+  ASSERT_TRUE(scores[2].is_true());
+  ASSERT_TRUE(scores[3].is_null());
+  ASSERT_TRUE(scores[4].empty());
+  ASSERT_TRUE(root["empty"].is_object());
+  ASSERT_TRUE(root["empty"].empty());
+  std::vector<std::string_view> keys;
+  for (auto [key, field]: root.fields()) {
+    keys.push_back(key);
+  }
+  ASSERT_EQ(keys, (std::vector<std::string_view> { "user", "scores", "empty" }));
+}
+
+TEST(JsonDocument, CanParseScalarRoot) {
+  ASSERT_EQ(zen::parse_json_document("7").unwrap().root().as_integer(), 7);
+  ASSERT_EQ(zen::parse_json_document("\"\"").unwrap().root().as_string(), "");
+  ASSERT_TRUE(zen::parse_json_document("[1,]").is_left());
+}
+
+TEST(JsonDocument, CanConvertToValue) {
+  auto doc = zen::parse_json_document("[{\"a\": [1, 2]}, \"b\"]").unwrap();
+  auto v1 = doc.root().to_value();
+  auto& a1 = v1.as_array();
+  ASSERT_EQ(a1.size(), 2);
+  ASSERT_EQ(a1[0].as_object().cbegin()->first, "a");
+  ASSERT_EQ(a1[0].as_object().cbegin()->second.as_array()[1].as_integer(), 2);
+  ASSERT_EQ(a1[1].as_string(), "b");
+}
+
+TEST(JsonParse, CanParseIntoPool) {
+  zen::growing_bump_ptr_pool pool;
+  auto v1 = zen::parse_json("{\"name\": \"a string that does not fit inline\", \"tags\": [1, \"x\", null]}", pool).unwrap();
+  auto& o1 = v1.as_object();
+  ASSERT_EQ(o1.size(), 2);
+  auto it = o1.cbegin();
+  ASSERT_EQ(it->first, "name");
+  ASSERT_EQ(it->second.as_string(), "a string that does not fit inline");
+  ++it;
+  ASSERT_EQ(it->first, "tags");
+  auto& a1 = it->second.as_array();
+  ASSERT_EQ(a1.size(), 3);
+  ASSERT_EQ(a1[0].as_integer(), 1);
+  ASSERT_EQ(a1[1].as_string(), "x");
+  ASSERT_TRUE(a1[2].is_null());
+  ASSERT_TRUE(a1.get_allocator() == zen::pool_allocator<char>(pool));
+  ASSERT_TRUE(zen::parse_json("[1,", pool).is_left());
+}
+
+TEST(JsonParse, CanConstructPoolValues) {
+  zen::growing_bump_ptr_pool pool;
+  zen::pool_value names { zen::value_type::array, pool };
+  names.as_array().push_back(zen::pool_value("Bob", pool));
+  names.as_array().push_back(zen::pool_value("Alice", pool));
+  ASSERT_EQ(names.as_array().size(), 2);
+  ASSERT_EQ(names.as_array()[1].as_string(), "Alice");
+  ASSERT_TRUE(names.as_array().get_allocator() == zen::pool_allocator<char>(pool));
+}
+
+TEST(JsonOndemand, CanLookUpNestedFields) {
+  auto doc = zen::parse_json_ondemand(
+    "{\"meta\": {\"tags\": [\"a\", \"]}\\\"\", {\"x\": [[]]}]}, "
+    "\"user\": {\"name\": \"Bob\\n\", \"id\": 42, \"score\": 1.5, \"admin\": false}}"
+  );
+  ASSERT_EQ(doc["user"]["id"].get<zen::bigint>().unwrap(), 42);
+  ASSERT_EQ(doc["user"]["name"].get<zen::string>().unwrap(), "Bob\n");
+  ASSERT_EQ(doc["user"]["score"].get<zen::fractional>().unwrap(), 1.5);
+  ASSERT_FALSE(doc["user"]["admin"].get<bool>().unwrap());
+  ASSERT_EQ(doc["meta"]["tags"][1].get<zen::string>().unwrap(), "]}\"");
+  ASSERT_EQ(doc["meta"]["tags"][2].get_raw_json().unwrap(), "{\"x\": [[]]}");
+  ASSERT_TRUE(doc["meta"]["tags"][2].get_type().unwrap() == zen::value_type::object);
+  auto tags = doc["meta"]["tags"].get<zen::value>().unwrap();
+  ASSERT_EQ(tags.as_array().size(), 3);
+}
+
+TEST(JsonOndemand, ReportsErrorsWhenValueIsRequested) {
+  auto doc = zen::parse_json_ondemand("{\"a\": [1, 2], \"b\": \"c\", \"d\": 1.5}");
+  ASSERT_TRUE(doc["x"]["y"].get<zen::bigint>().left() == zen::json_parse_error::no_such_field);
+  ASSERT_TRUE(doc["a"][2].get<zen::bigint>().left() == zen::json_parse_error::index_out_of_range);
+  ASSERT_TRUE(doc["b"].get<zen::bigint>().left() == zen::json_parse_error::incorrect_type);
+  ASSERT_TRUE(doc["d"].get<zen::bigint>().left() == zen::json_parse_error::incorrect_type);
+  ASSERT_TRUE(doc["b"]["c"].get<zen::bigint>().left() == zen::json_parse_error::incorrect_type);
+  ASSERT_TRUE(zen::parse_json_ondemand("  ").has_error());
+  ASSERT_TRUE(zen::parse_json_ondemand("{\"a\": [1, 2").get_raw_json().is_left());
+  ASSERT_TRUE(zen::parse_json_ondemand("{\"a\": [1, 2], \"b\": 1x}")["b"].get<zen::bigint>().is_left());
+}
+
+TEST(JsonPushParser, CanParseAtEverySplitPoint) {
+  std::string in = " {\"name\": \"Bob \\\"the\\\\ builder\\u00e9\", \"tags\": [true, false, null, -12, 3.5e2, []], \"o\": {}} ";
+  for (std::size_t i = 0; i <= in.size(); ++i) {
+    zen::json_push_parser parser;
+    ASSERT_TRUE(parser.feed(in.data(), i).is_right());
+    ASSERT_TRUE(parser.feed(in.data() + i, in.size() - i).is_right());
+    auto v1 = parser.finish().unwrap();
+    auto it = v1.as_object().cbegin();
+    ASSERT_EQ(it->second.as_string(), "Bob \"the\\ builder\xC3\xA9");
+    ++it;
+    auto& tags = it->second.as_array();
+    ASSERT_EQ(tags.size(), 6);
+    ASSERT_TRUE(tags[0].is_true());
+    ASSERT_TRUE(tags[2].is_null());
+    ASSERT_EQ(tags[3].as_integer(), -12);
+    ASSERT_EQ(tags[4].as_fractional(), 350);
+    ++it;
+    ASSERT_EQ(it->first, "o");
+  }
+}
+
+TEST(JsonPushParser, CanParseOneByteAtATime) {
+  std::string in = "[1, 23, \"ab\", {\"k\": nul";
+  zen::json_push_parser parser;
+  for (auto ch: in) {
+    ASSERT_TRUE(parser.feed(&ch, 1).is_right());
+  }
+  ASSERT_TRUE(parser.finish().is_left());
+  in = "1234";
+  for (auto ch: in) {
+    ASSERT_TRUE(parser.feed(&ch, 1).is_right());
+  }
+  ASSERT_EQ(parser.finish().unwrap().as_integer(), 1234);
+}
+
+TEST(JsonPushParser, RejectsInvalidInput) {
+  for (std::string in: { "[1,]", "{\"a\" 1}", "[1] 2", "tru", "[\"a\\x\"]", "{\"a\": 1]", "[01]" }) {
+    zen::json_push_parser parser;
+    auto status = parser.feed(in.data(), in.size());
+    ASSERT_TRUE(status.is_left() || parser.finish().is_left()) << in;
+  }
+}
+
+TEST(JsonHandler, ReportsEventsInOrder) {
+
+  struct recorder : zen::json_handler {
+    std::vector<std::string> events;
+    void on_object_start() override { events.push_back("{"); }
+    void on_object_end() override { events.push_back("}"); }
+    void on_array_start() override { events.push_back("["); }
+    void on_array_end() override { events.push_back("]"); }
+    void on_key(std::string_view key) override { events.push_back("key:" + std::string(key)); }
+    void on_string(std::string_view str) override { events.push_back("str:" + std::string(str)); }
+    void on_integer(zen::bigint x) override { events.push_back("int:" + std::to_string(x)); }
+    void on_fractional(zen::fractional) override { events.push_back("frac"); }
+    void on_boolean(bool x) override { events.push_back(x ? "true" : "false"); }
+    void on_null() override { events.push_back("null"); }
+  };
+
+  recorder r;
+  ASSERT_TRUE(zen::parse_json("{\"a\\n\": [1, \"x\", 2.5, true, null], \"b\": {}}", r).is_right());
+  ASSERT_EQ(r.events, (std::vector<std::string> {
+    "{", "key:a\n", "[", "int:1", "str:x", "frac", "true", "null", "]", "key:b", "{", "}", "}"
+  }));
+
+  recorder r2;
+  ASSERT_TRUE(zen::parse_json("[1, 2", r2).is_left());
+}
+
+TEST(JsonEncoder, WritesToOutputSink) {
+  std::string out;
+  zen::string_sink sink { out };
+  auto encoder = zen::make_json_encoder(sink);
+  std::vector<double> numbers { 1, 2.5, 0.1 };
+  encoder->transform(numbers);
+  ASSERT_EQ(out, "[1.0,2.5,0.1]");
+  out.clear();
+  std::string text = "quote \" backslash \\ newline \n bell \x07";
+  encoder->transform(text);
+  ASSERT_EQ(out, "\"quote \\\" backslash \\\\ newline \\n bell \\u0007\"");
+  out.clear();
+  long long big = -9223372036854775807LL;
+  encoder->transform(big);
+  ASSERT_EQ(out, "-9223372036854775807");
+}
+
+static std::string naive_escape_json(const std::string& in) {
+  std::string out = "\"";
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    unsigned char ch = in[i];
+    switch (ch) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      case '\r': out += "\\r"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      default:
+        if (ch < 0x20) {
+          char buffer[8];
+          std::snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+          out += buffer;
+        } else if (ch < 0x80) {
+          out += ch;
+        } else if (ch >= 0xC2 && ch <= 0xDF && i + 1 < in.size() && (in[i + 1] & 0xC0) == 0x80) {
+          out += in.substr(i, 2);
+          i += 1;
+        } else {
+          out += "\\ufffd";
+        }
+    }
+  }
+  return out + "\"";
+}
+
+TEST(JsonEncoder, EscapesStringsAndValidatesUtf8) {
+  std::string out;
+  zen::string_sink sink { out };
+  auto encoder = zen::make_json_encoder(sink);
+  auto encode = [&](std::string in) {
+    out.clear();
+    encoder->transform(in);
+    return out;
+  };
+  ASSERT_EQ(encode("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"), "\"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80\"");
+  ASSERT_EQ(encode("\xFF"), "\"\\ufffd\"");
+  ASSERT_EQ(encode("a\xE2\x82"), "\"a\\ufffd\\ufffd\"");
+  ASSERT_EQ(encode("\xED\xA0\x80"), "\"\\ufffd\\ufffd\\ufffd\"");
+  ASSERT_EQ(encode("\xC0\xAF"), "\"\\ufffd\\ufffd\"");
+  ASSERT_EQ(encode("\xF4\x90\x80\x80"), "\"\\ufffd\\ufffd\\ufffd\\ufffd\"");
+  std::mt19937 rng { 7 };
+  const char alphabet[] = { 'a', 'b', '"', '\\', '\n', '\x01', '\x1F', ' ', '\xC3', '\xA9', '\x80', '~' };
+  for (std::size_t i = 0; i < 2000; ++i) {
+    std::string in;
+    auto size = rng() % 100;
+    for (std::size_t j = 0; j < size; ++j) {
+      in += rng() % 4 == 0 ? alphabet[rng() % sizeof(alphabet)] : 'x';
+    }
+    ASSERT_EQ(encode(in), naive_escape_json(in));
+  }
+}
+
+TEST(JsonPrint, EscapesStrings) {
+  zen::object o1;
+  o1.emplace(zen::string("a\"b"), zen::value(zen::string("tab\there")));
+  ASSERT_EQ(zen::to_string(zen::value(o1)), "{\n  \"a\\\"b\": \"tab\\there\"\n}");
+}
+
+TEST(JsonEncoder, WritesShortestRoundTripFractionals) {
+  std::string out;
+  zen::string_sink sink { out };
+  auto encoder = zen::make_json_encoder(sink);
+  auto encode = [&](auto x) {
+    out.clear();
+    encoder->transform(x);
+    return out;
+  };
+  ASSERT_EQ(encode(0.1), "0.1");
+  ASSERT_EQ(encode(1e21), "1e+21");
+  ASSERT_EQ(encode(-0.0), "-0.0");
+  ASSERT_EQ(encode(100.0), "100.0");
+  ASSERT_EQ(encode(0.1f), "0.1");
+  ASSERT_EQ(encode(std::numeric_limits<double>::infinity()), "null");
+  std::mt19937_64 rng { 3 };
+  for (std::size_t i = 0; i < 10000; ++i) {
+    auto bits = rng();
+    auto x = std::bit_cast<double>(bits);
+    if (!std::isfinite(x)) {
+      continue;
+    }
+    auto text = encode(x);
+    auto v1 = zen::parse_json(text).unwrap();
+    ASSERT_TRUE(v1.is_fractional()) << text;
+    ASSERT_EQ(std::bit_cast<std::uint64_t>(v1.as_fractional()), bits) << text;
+    ASSERT_EQ(zen::to_string(zen::value(x)), text);
+  }
+}
@@ -0,0 +1,85 @@
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "zen/ndjson.hpp"
+
+static std::string make_lines(std::size_t count) {
+  std::string out;
+  for (std::size_t i = 0; i < count; ++i) {
+    out += "{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\", \"b\"]}\n";
+    if (i % 7 == 0) {
+      out += "  \r\n";
+    }
+  }
+  return out;
+}
+
+TEST(Ndjson, ParsesLinesInOrder) {
+  auto in = make_lines(1000);
+  for (std::size_t threads: { 1, 4 }) {
+    auto results = zen::parse_ndjson(in, { .threads = threads, .chunk_size = 100 });
+    ASSERT_EQ(results.size(), 1000);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      ASSERT_TRUE(results[i].is_right());
+      ASSERT_EQ(results[i].right().as_object().cbegin()->second.as_integer(), i);
+    }
+  }
+}
+
+TEST(Ndjson, ReportsOffsetsOfInvalidLines) {
+  std::string in = "[1]\n{\"a\":\n\ntrue";
+  std::vector<std::size_t> offsets;
+  std::vector<bool> ok;
+  zen::parse_ndjson(in, [&](std::size_t offset, zen::json_parse_result result) {
+    offsets.push_back(offset);
+    ok.push_back(result.is_right());
+  });
+  ASSERT_EQ(offsets, (std::vector<std::size_t> { 0, 4, 11 }));
+  ASSERT_EQ(ok, (std::vector<bool> { true, false, true }));
+}
+
+TEST(Ndjson, CanParseUnorderedFromFile) {
+  auto filename = std::filesystem::temp_directory_path() / "zen-ndjson-test.jsonl";
+  {
+    std::ofstream out { filename, std::ios::binary };
+    out << make_lines(500);
+  }
+  std::mutex mutex;
+  std::vector<zen::bigint> ids;
+  auto result = zen::parse_ndjson_file(filename, [&](std::size_t, zen::json_parse_result result) {
+    auto id = result.right().as_object().cbegin()->second.as_integer();
+    std::lock_guard lock { mutex };
+    ids.push_back(id);
+  }, { .threads = 3, .chunk_size = 64, .ordered = false });
+  std::filesystem::remove(filename);
+  ASSERT_TRUE(result.is_right());
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(ids.size(), 500);
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    ASSERT_EQ(ids[i], i);
+  }
+}
+
+TEST(Ndjson, RethrowsExceptionsFromCallback) {
+  auto in = make_lines(1000);
+  for (bool ordered: { true, false }) {
+    std::atomic<std::size_t> count = 0;
+    auto parse = [&] {
+      zen::parse_ndjson(in, [&](std::size_t, zen::json_parse_result) {
+        if (++count == 100) {
+          throw std::runtime_error("stop");
+        }
+      }, { .threads = 4, .chunk_size = 100, .ordered = ordered });
+    };
+    ASSERT_THROW(parse(), std::runtime_error);
+  }
+}
@@ -0,0 +1,52 @@
+
+#include <string>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "zen/output_sink.hpp"
+
+TEST(OutputSink, CollectsWritesUntilFlushed) {
+  std::string out;
+  zen::string_sink sink { out, 32 };
+  sink.write("Hello");
+  sink.put(',');
+  sink.write_integer(-42);
+  ASSERT_EQ(out, "");
+  sink.flush();
+  ASSERT_EQ(out, "Hello,-42");
+  sink.write("a string that does not fit in the buffer");
+  ASSERT_EQ(out, "Hello,-42a string that does not fit in the buffer");
+  auto ptr = sink.reserve(64);
+  std::fill(ptr, ptr + 64, 'x');
+  sink.commit(64);
+  sink.flush();
+  ASSERT_EQ(out.size(), 49 + 64);
+  ASSERT_EQ(out.back(), 'x');
+}
+
+TEST(OutputSink, AcceptsZeroCapacity) {
+  std::string out;
+  {
+    zen::string_sink sink { out, 0 };
+    sink.put('a');
+    sink.put('b');
+    sink.write("cd");
+    sink.write_integer(7);
+  }
+  ASSERT_EQ(out, "abcd7");
+}
+
+TEST(OutputSink, CanWriteToFileDescriptor) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  {
+    zen::fd_sink sink { fds[1] };
+    sink.write("over the pipe");
+  }
+  close(fds[1]);
+  char buffer[32];
+  auto count = read(fds[0], buffer, sizeof(buffer));
+  close(fds[0]);
+  ASSERT_EQ(std::string(buffer, count), "over the pipe");
+}
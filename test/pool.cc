@@ -1,5 +1,14 @@
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 #include "zen/bump_ptr_pool.hpp"
+#include "zen/size_class_pool.hpp"
+#include "zen/json.hpp"
 
 #include "gtest/gtest.h"
 
@@ -44,6 +53,114 @@ TEST(BumpPtrPoolTest, TestRunsDestructor) {
   ASSERT_EQ(count, 3);
 }
 
+TEST(BumpPtrPoolTest, TrivialObjectsHaveNoHeader) {
+  zen::bump_ptr_pool p { 1024 };
+  std::vector<int*> numbers;
+  for (int i = 0; i < 256; ++i) {
+    auto ptr = zen::construct<int>(p, i);
+    ASSERT_NE(ptr, nullptr);
+    numbers.push_back(ptr);
+  }
+  ASSERT_EQ(zen::construct<int>(p, 256), nullptr);
+  for (int i = 0; i < 256; ++i) {
+    ASSERT_EQ(*numbers[i], i);
+    if (i > 0) {
+      ASSERT_EQ(numbers[i], numbers[i-1] + 1);
+    }
+  }
+}
+
+TEST(BumpPtrPoolTest, MixesTrivialAndNonTrivialObjects) {
+
+  int count = 0;
+
+  struct Foo {
+    int& count;
+
+    ~Foo() {
+      count++;
+    }
+  };
+
+  {
+    zen::growing_bump_ptr_pool p { 64 };
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_NE(zen::construct<double>(p, i), nullptr);
+      ASSERT_NE(zen::construct<Foo>(p, count), nullptr);
+    }
+  }
+
+  ASSERT_EQ(count, 100);
+}
+
+TEST(BumpPtrPoolTest, RewindDestroysObjectsAfterMark) {
+
+  std::vector<int> destroyed;
+
+  struct Foo {
+    int value;
+    std::vector<int>& destroyed;
+
+    ~Foo() {
+      destroyed.push_back(value);
+    }
+  };
+
+  zen::bump_ptr_pool p { 1024 };
+  zen::construct<Foo>(p, 1, destroyed);
+  auto m = p.mark();
+  auto f2 = zen::construct<Foo>(p, 2, destroyed);
+  zen::construct<int>(p, 42);
+  zen::construct<Foo>(p, 3, destroyed);
+  p.rewind(m);
+  ASSERT_EQ(destroyed, (std::vector<int> { 2, 3 }));
+  ASSERT_EQ(zen::construct<Foo>(p, 4, destroyed), f2);
+  p.reset();
+  ASSERT_TRUE(p.empty());
+  ASSERT_EQ(destroyed, (std::vector<int> { 2, 3, 1, 4 }));
+  struct alignas(64) Bar {
+    std::vector<int>& destroyed;
+    ~Bar() {
+      destroyed.push_back(5);
+    }
+  };
+  auto bar = zen::construct<Bar>(p, destroyed);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(bar) % 64, 0);
+  p.reset();
+  ASSERT_EQ(destroyed.back(), 5);
+}
+
+TEST(GrowingBumpPtrPoolTest, RewindReusesChunks) {
+
+  int count = 0;
+
+  struct Foo {
+    int& count;
+
+    ~Foo() {
+      count++;
+    }
+  };
+
+  zen::growing_bump_ptr_pool p { 64 };
+  zen::construct<Foo>(p, count);
+  auto m = p.mark();
+  std::vector<Foo*> first;
+  for (int i = 0; i < 1000; ++i) {
+    first.push_back(zen::construct<Foo>(p, count));
+  }
+  p.rewind(m);
+  ASSERT_EQ(count, 1000);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(zen::construct<Foo>(p, count), first[i]);
+  }
+  p.reset();
+  ASSERT_EQ(count, 2001);
+  for (int i = 0; i < 1000; ++i) {
+    zen::construct<Foo>(p, count);
+  }
+}
+
 TEST(GrowingBumpPtrPoolTest, TestConstructNextChunk) {
   zen::growing_bump_ptr_pool p { 2 };
   auto one = zen::construct<int>(p, 1);
@@ -62,3 +179,245 @@ TEST(GrowingBumpPtrPoolTest, TestConstructNextChunk) {
   ASSERT_EQ(*four, 4);
   ASSERT_EQ(*five, 5);
 }
+
+TEST(ConcurrentBumpPtrPoolTest, ThreadsAllocateFromOwnChunks) {
+
+  std::atomic<int> count = 0;
+
+  struct Foo {
+    std::size_t value;
+    std::atomic<int>& count;
+
+    ~Foo() {
+      count++;
+    }
+  };
+
+  const std::size_t num_threads = 4;
+  const std::size_t per_thread = 10000;
+
+  {
+    zen::concurrent_bump_ptr_pool shared { 1024 };
+    shared.reserve(8);
+    std::vector<std::vector<Foo*>> objects(num_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        zen::thread_local_pool pool { shared };
+        for (std::size_t i = 0; i < per_thread; ++i) {
+          objects[t].push_back(zen::construct<Foo>(pool, t * per_thread + i, count));
+        }
+        auto large = pool.allocate(4096, 64, zen::destroy_nothing);
+        ASSERT_NE(large, nullptr);
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(large) % 64, 0);
+      });
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    for (std::size_t t = 0; t < num_threads; ++t) {
+      for (std::size_t i = 0; i < per_thread; ++i) {
+        ASSERT_EQ(objects[t][i]->value, t * per_thread + i);
+      }
+    }
+    ASSERT_EQ(count, 0);
+  }
+
+  ASSERT_EQ(count, num_threads * per_thread);
+}
+
+TEST(ConcurrentBumpPtrPoolTest, ThreadsDrainReservedChunks) {
+
+  const std::size_t num_threads = 8;
+  const std::size_t num_reserved = 256;
+
+  zen::concurrent_bump_ptr_pool shared { 256 };
+  shared.reserve(num_reserved);
+
+  std::atomic<bool> start = false;
+  std::vector<std::vector<zen::bump_ptr_pool*>> acquired(num_threads);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      while (!start.load(std::memory_order_acquire));
+      for (std::size_t i = 0; i < 2 * num_reserved / num_threads; ++i) {
+        acquired[t].push_back(shared.acquire_chunk(16));
+      }
+    });
+  }
+  start.store(true, std::memory_order_release);
+  for (auto& thread: threads) {
+    thread.join();
+  }
+
+  // No chunk may have been handed to more than one thread.
+  std::vector<zen::bump_ptr_pool*> all;
+  for (auto& chunks: acquired) {
+    for (auto chunk: chunks) {
+      ASSERT_NE(chunk, nullptr);
+      all.push_back(chunk);
+    }
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
+TEST(PoolAllocatorTest, CarvesContainersOutOfPool) {
+
+  struct counting_pool {
+    zen::growing_bump_ptr_pool pool;
+    std::size_t count = 0;
+    void* allocate(std::size_t size, std::size_t alignment, zen::destroy_fn destroy) {
+      ++count;
+      return pool.allocate(size, alignment, destroy);
+    }
+  };
+
+  counting_pool p;
+  std::vector<int, zen::pool_allocator<int>> numbers { p };
+  for (int i = 0; i < 100; ++i) {
+    numbers.push_back(i);
+  }
+  ASSERT_GT(p.count, 0);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(numbers[i], i);
+  }
+}
+
+TEST(SizeClassPoolTest, ReusesFreedObjects) {
+  zen::size_class_pool pool;
+  auto a = zen::construct<int>(pool, 1);
+  auto b = zen::construct<int>(pool, 2);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(a, b);
+  pool.deallocate(a);
+  auto c = zen::construct<int>(pool, 3);
+  ASSERT_EQ(c, a);
+  ASSERT_EQ(*b, 2);
+  ASSERT_EQ(*c, 3);
+  auto large = pool.allocate(100 * 1024, 64);
+  ASSERT_NE(large, nullptr);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(large) % 64, 0);
+  std::memset(large, 0xAB, 100 * 1024);
+  pool.deallocate(large);
+}
+
+TEST(SizeClassPoolTest, RunsDestructors) {
+
+  int count = 0;
+
+  struct Foo {
+    int& count;
+    char padding[100];
+    Foo(int& count): count(count) {}
+    ~Foo() { ++count; }
+  };
+
+  {
+    zen::size_class_pool pool;
+    auto a = zen::construct<Foo>(pool, count);
+    zen::construct<Foo>(pool, count);
+    zen::construct<Foo>(pool, count);
+    pool.deallocate(a);
+    ASSERT_EQ(count, 1);
+  }
+
+  ASSERT_EQ(count, 3);
+}
+
+TEST(SizeClassPoolTest, ThreadsFreeEachOthersObjects) {
+
+  constexpr std::size_t num_threads = 4;
+  constexpr std::size_t per_thread = 2000;
+
+  zen::size_class_pool pool;
+  std::vector<std::vector<std::size_t*>> objects(num_threads);
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (std::size_t i = 0; i < per_thread; ++i) {
+        auto object = static_cast<std::size_t*>(pool.allocate(8 + (i % 300), 8));
+        ASSERT_NE(object, nullptr);
+        *object = t * per_thread + i;
+        objects[t].push_back(object);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  // Every thread frees the objects of the next one.
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      auto& theirs = objects[(t + 1) % num_threads];
+      for (std::size_t i = 0; i < per_thread; ++i) {
+        ASSERT_EQ(*theirs[i], ((t + 1) % num_threads) * per_thread + i);
+        pool.deallocate(theirs[i]);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+}
+
+TEST(BumpPtrPoolTest, CanBeBackedByMappedMemory) {
+  for (auto backing: { zen::pool_backing::mapped, zen::pool_backing::huge_pages }) {
+    zen::growing_bump_ptr_pool pool { 1024 * 1024, backing };
+    std::vector<std::size_t*> numbers;
+    for (std::size_t i = 0; i < 100000; ++i) {
+      auto n = zen::construct<std::size_t>(pool, i);
+      ASSERT_NE(n, nullptr);
+      numbers.push_back(n);
+    }
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+      ASSERT_EQ(*numbers[i], i);
+    }
+  }
+  zen::bump_ptr_pool pool { 4 * 1024 * 1024, zen::pool_backing::huge_pages };
+  ASSERT_TRUE(pool.backing() == zen::pool_backing::huge_pages);
+  ASSERT_NE(pool.allocate(4 * 1024 * 1024, 1), nullptr);
+}
+
+TEST(GrowingBumpPtrPoolTest, CollectsStats) {
+
+  struct Foo {
+    std::size_t value;
+    ~Foo() {}
+  };
+
+  zen::pool_stats stats;
+  {
+    zen::growing_bump_ptr_pool pool { 64 };
+    pool.set_stats(&stats);
+    zen::construct<char>(pool, 'a');
+    zen::construct<std::size_t>(pool, 1);
+    ASSERT_EQ(stats.num_allocations, 2);
+    ASSERT_EQ(stats.bytes_requested, 1 + sizeof(std::size_t));
+    ASSERT_EQ(stats.bytes_padding, sizeof(std::size_t) - 1);
+    ASSERT_EQ(stats.bytes_headers, 0);
+    auto m = pool.mark();
+    for (std::size_t i = 0; i < 10; ++i) {
+      zen::construct<Foo>(pool, i);
+    }
+    ASSERT_GT(stats.num_chunks, 1);
+    ASSERT_GT(stats.bytes_headers, 0);
+    auto high = stats.bytes_in_use;
+    pool.rewind(m);
+    ASSERT_EQ(stats.num_destroyed, 10);
+    ASSERT_EQ(stats.high_water_mark, high);
+    ASSERT_EQ(stats.bytes_in_use, 2 * sizeof(std::size_t));
+    zen::construct<Foo>(pool, 11);
+  }
+  ASSERT_EQ(stats.num_destroyed, 11);
+  ASSERT_EQ(stats.bytes_in_use, 0);
+  ASSERT_GE(stats.bytes_reserved, stats.high_water_mark);
+
+  std::ostringstream out;
+  zen::make_json_encoder(out)->transform(stats);
+  ASSERT_NE(out.str().find("\"num_destroyed\":11"), std::string::npos);
+}
@@ -0,0 +1,116 @@
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "zen/seq_map.hpp"
+
+using string_map = zen::seq_map<std::string, int>;
+
+static std::vector<std::string> keys_of(const string_map& map) {
+  std::vector<std::string> keys;
+  for (const auto& [key, value]: map) {
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+TEST(SeqMap, KeepsInsertionOrder) {
+  string_map map;
+  ASSERT_TRUE(map.emplace("b", 1).second);
+  ASSERT_TRUE(map.emplace("a", 2).second);
+  ASSERT_TRUE(map.emplace(std::string("c"), 3).second);
+  ASSERT_FALSE(map.emplace("a", 4).second);
+  ASSERT_EQ(map.size(), 3);
+  ASSERT_EQ(keys_of(map), (std::vector<std::string> { "b", "a", "c" }));
+  ASSERT_EQ(map["a"], 2);
+  map["d"] = 5;
+  ASSERT_EQ(keys_of(map), (std::vector<std::string> { "b", "a", "c", "d" }));
+}
+
+TEST(SeqMap, CanFindByStringView) {
+  string_map map;
+  map.emplace("foo", 1);
+  std::string_view key = "foo";
+  ASSERT_TRUE(map.contains(key));
+  ASSERT_FALSE(map.contains(std::string_view("bar")));
+  auto it = map.find(key);
+  ASSERT_NE(it, map.end());
+  ASSERT_EQ(it->second, 1);
+  const auto& const_map = map;
+  ASSERT_EQ(const_map.find(key)->second, 1);
+  ASSERT_EQ(const_map.find(std::string_view("bar")), const_map.cend());
+}
+
+TEST(SeqMap, CanEraseAndCompact) {
+  string_map map;
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(std::to_string(i), i);
+  }
+  for (int i = 0; i < 1000; i += 3) {
+    ASSERT_EQ(map.erase(std::to_string(i)), 1);
+  }
+  ASSERT_EQ(map.erase(std::string_view("0")), 0);
+  auto it = map.erase(map.find("1"));
+  ASSERT_EQ(it->first, "2");
+  for (int i = 1000; i < 2000; ++i) {
+    map.emplace(std::to_string(i), i);
+  }
+  int expected = 2;
+  for (const auto& [key, value]: map) {
+    ASSERT_EQ(key, std::to_string(expected));
+    ASSERT_EQ(value, expected);
+    do {
+      ++expected;
+    } while (expected < 1000 && expected % 3 == 0);
+  }
+  ASSERT_EQ(expected, 2000);
+  ASSERT_EQ(map.size(), 1000 - 334 - 1 + 1000);
+  map.shrink_to_fit();
+  ASSERT_EQ(map.find("500")->second, 500);
+}
+
+TEST(SeqMap, CanCopyAndMove) {
+  string_map map;
+  for (int i = 0; i < 100; ++i) {
+    map.emplace(std::to_string(i), i);
+  }
+  auto copy = map;
+  map.erase("5");
+  ASSERT_TRUE(copy.contains("5"));
+  ASSERT_FALSE(map.contains("5"));
+  auto moved = std::move(copy);
+  copy = map;
+  ASSERT_EQ(moved["42"], 42);
+  ASSERT_EQ(copy.size(), 99);
+  ASSERT_EQ(copy["42"], 42);
+  ASSERT_FALSE(copy.contains("5"));
+}
+
+TEST(SeqMap, AssignmentKeepsNonPropagatingAllocator) {
+  using pmr_map = zen::seq_map<int, int, std::pmr::polymorphic_allocator<std::pair<int, int>>>;
+  std::pmr::monotonic_buffer_resource arena1;
+  std::pmr::monotonic_buffer_resource arena2;
+  pmr_map a { &arena1 };
+  pmr_map b { &arena2 };
+  for (int i = 0; i < 100; ++i) {
+    b.emplace(i, i * 2);
+  }
+  a.emplace(-1, -1);
+  a = b;
+  ASSERT_EQ(a.get_allocator().resource(), &arena1);
+  ASSERT_EQ(a.size(), 100);
+  ASSERT_FALSE(a.contains(-1));
+  ASSERT_EQ(a[42], 84);
+  pmr_map c { &arena1 };
+  c = std::move(b);
+  ASSERT_EQ(c.get_allocator().resource(), &arena1);
+  ASSERT_EQ(c.size(), 100);
+  ASSERT_EQ(c[99], 198);
+  ASSERT_TRUE(b.empty());
+  b.emplace(1, 1);
+  ASSERT_EQ(b[1], 1);
+}
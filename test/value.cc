@@ -0,0 +1,63 @@
+
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "zen/pool_resource.hpp"
+#include "zen/value.hpp"
+
+TEST(Value, StoresShortStringsInline) {
+  zen::value empty { std::string() };
+  ASSERT_TRUE(empty.is_string());
+  ASSERT_EQ(empty.as_string(), "");
+  zen::value short_str { std::string(ZEN_VALUE_INLINE_STRING_CAPACITY, 'a') };
+  auto view = short_str.as_string();
+  ASSERT_EQ(view.size(), ZEN_VALUE_INLINE_STRING_CAPACITY);
+  ASSERT_GE(view.data(), reinterpret_cast<const char*>(&short_str));
+  ASSERT_LT(view.data(), reinterpret_cast<const char*>(&short_str + 1));
+  zen::value long_str { std::string(ZEN_VALUE_INLINE_STRING_CAPACITY + 1, 'b') };
+  ASSERT_TRUE(long_str.get_type() == zen::value_type::string);
+  ASSERT_EQ(long_str.as_string(), std::string(ZEN_VALUE_INLINE_STRING_CAPACITY + 1, 'b'));
+}
+
+TEST(Value, CanCopyMoveAndAssign) {
+  zen::array elements;
+  for (int i = 0; i < 100; ++i) {
+    elements.push_back(zen::value(zen::bigint(i)));
+    elements.push_back(zen::value(std::to_string(i)));
+    elements.push_back(zen::value(std::string(20 + i, 'x')));
+  }
+  zen::value a1 { std::move(elements) };
+  zen::value a2 { a1 };
+  ASSERT_EQ(a2.as_array().size(), 300);
+  ASSERT_NE(&a1.as_array(), &a2.as_array());
+  zen::value a3 { std::move(a1) };
+  ASSERT_TRUE(a1.is_null());
+  a2 = zen::value(true);
+  ASSERT_TRUE(a2.is_true());
+  a2 = a3;
+  a3 = zen::value(std::string("short"));
+  ASSERT_EQ(a3.as_string(), "short");
+  ASSERT_EQ(a2.as_array()[297].as_integer(), 99);
+  ASSERT_EQ(a2.as_array()[298].as_string(), "99");
+  ASSERT_EQ(a2.as_array()[299].as_string(), std::string(119, 'x'));
+}
+
+TEST(Value, CanAllocateFromMemoryResource) {
+  zen::pool_resource arena;
+  zen::pmr_value names { zen::value_type::array, &arena };
+  names.as_array().push_back(zen::pmr_value("Bob", &arena));
+  names.as_array().push_back(zen::pmr_value("a name that does not fit inline", &arena));
+  zen::pmr_value people { zen::value_type::object, &arena };
+  people.as_object().emplace(zen::pmr_value::string_type("names", &arena), names);
+  auto copy = people;
+  ASSERT_EQ(copy.as_object().get_allocator().resource(), &arena);
+  auto& copied_names = copy.as_object().find("names")->second.as_array();
+  ASSERT_EQ(copied_names.get_allocator().resource(), &arena);
+  ASSERT_EQ(copied_names[1].as_string(), "a name that does not fit inline");
+  std::pmr::vector<std::pmr::string> strings { &arena };
+  strings.emplace_back("a string that is allocated inside the arena");
+  ASSERT_EQ(strings[0].get_allocator().resource(), &arena);
+}